@@ -7,6 +7,8 @@
 #include "agent/path_planning/Point.h"
 #include "agent/path_planning/Rectangle.h"
 
+class RectangleBatch;
+
 #define TO_RAD 0.01745329252f
 #define TO_DEG 57.2957795131f
 #define PI 3.14159265359f
@@ -61,9 +63,29 @@ public:
 	static bool doesLineSegmentIntersectNonInflatedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 	static bool isPointInRectangle(const Point& p, const Rectangle& rectangle);
 	static bool isPointInNonInflatedRectangle(const Point& p, const Rectangle& rectangle);
+	
+	// Batch variants over the rectangles [first, last) of a batch. Vectorized if SSE2/AVX is available, results are identical to the single rectangle checks
+	static bool doesLineSegmentIntersectAnyRectangle(const Point& lStart, const Point& lEnd, const RectangleBatch& batch, int first, int last);
+	static bool isPointInAnyRectangle(const Point& p, const RectangleBatch& batch, int first, int last);
+
+	// Capsules are line segments with a radius. Swept rectangles (see Rectangle) are checked as capsules, only the part of the capsule which is occupied in [start, end] is used
+	static bool doesLineSegmentIntersectCapsule(const Point& lStart, const Point& lEnd, const Point& cStart, const Point& cEnd, double radius);
+	static bool doesLineSegmentIntersectSweptRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle, double start, double end, bool inflated);
+	static bool isPointInSweptRectangle(const Point& p, const Rectangle& rectangle, double start, double end, bool inflated);
+	
+	/** Computes when the part of a swept rectangle which touches a line segment is occupied
+	 * @param occupiedFrom Receives the time the first touching point of the rectangle gets occupied
+	 * @param occupiedUntil Receives the time the last touching point of the rectangle gets free again
+	 * @return False if the line segment does not touch the rectangle */
+	static bool getSweptRectangleOccupation(const Point& lStart, const Point& lEnd, const Rectangle& rectangle, bool inflated, double& occupiedFrom, double& occupiedUntil);
+	
+	/** Checks whether two reservations occupy a common point at a common time, using the non-inflated shapes. Swept rectangles are restricted to the part of the capsule which is occupied while the other reservation exists
+	 * @return True iff the reservations conflict */
+	static bool doReservationsOverlap(const Rectangle& r1, const Rectangle& r2);
 
 	static double projectPointOnLineSegment(const Point& lStart, const Point& lEnd, const Point& point);
 	static double getDistanceToLineSegment(const Point& lStart, const Point& lEnd, const Point& point);
+	static double getDistanceBetweenLineSegments(const Point& l1Start, const Point& l1End, const Point& l2Start, const Point& l2End);
 	static int getDirectionToLineSegment(const Point& lStart, const Point& lEnd, const Point& point);
 
 	static double getDistanceToLine(const Point& lStart, const Point& lEnd, const Point& point);
@@ -84,6 +106,22 @@ private:
 	static bool doesLineSegmentIntersectAxisAlignedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 	static bool doesLineSegmentIntersectNonAxisAlignedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 	static bool isPointInAxisAlignedRectangle(const Point& p, const Rectangle& rectangle);
+	
+	/** Computes the section of the center line of a swept rectangle which may touch a line segment. The section is conservative, it may be slightly too long
+	 * @param sectionStart Receives the start of the section in [0, 1]
+	 * @param sectionEnd Receives the end of the section in [0, 1]
+	 * @return False if the line segment does not touch the rectangle */
+	static bool getSweptRectangleSection(const Point& lStart, const Point& lEnd, const Rectangle& rectangle, bool inflated, double& sectionStart, double& sectionEnd);
+	
+	/** Computes the part of the center line of a swept rectangle which is occupied at some point in [start, end]
+	 * @param sectionStart Receives the start point of the section
+	 * @param sectionEnd Receives the end point of the section
+	 * @return False if no part of the rectangle is occupied in [start, end] */
+	static bool getOccupiedSweptSection(const Rectangle& rectangle, double start, double end, Point& sectionStart, Point& sectionEnd);
+	
+	/** Computes the distance between a line segment and the non inflated shape of a rectangle
+	 * @return The distance, 0 if the line segment touches the rectangle */
+	static double getDistanceToNonInflatedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle);
 };
 
 #endif //PROJECT_MATH_H
@@ -0,0 +1,74 @@
+#ifndef AGENT_THREADPOOL_H_
+#define AGENT_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads which execute the iterations of a parallel for loop.
+ * The calling thread takes part in the loop and only returns when every iteration is finished
+ */
+class ThreadPool
+{
+	public:
+		/**
+		 * Constructor
+		 * @param threadCount, number of threads executing a loop including the calling thread. 0 uses one thread per hardware thread
+		 */
+		explicit ThreadPool(unsigned int threadCount);
+
+		/**
+		 * Destructor, waits for the workers to finish
+		 */
+		virtual ~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/**
+		 * Calls task(i) for every i in [0, count). Iterations may run in any order and concurrently
+		 * @param count, number of iterations
+		 * @param task, the loop body
+		 */
+		void parallelFor(int count, const std::function<void(int)>& task);
+
+		/**
+		 * Returns the number of threads executing a loop including the calling thread
+		 * @return unsigned int
+		 */
+		unsigned int getThreadCount() const;
+
+	private:
+		/**
+		 * Main function of the worker threads
+		 */
+		void workerLoop();
+
+		/**
+		 * Executes iterations of the current loop until none are left
+		 */
+		void runIterations();
+
+		std::vector<std::thread> workers;
+
+		// Guards everything below except nextIteration
+		std::mutex mutex;
+		std::condition_variable loopStarted;
+		std::condition_variable loopFinished;
+
+		// The current loop, only valid while a loop is running
+		const std::function<void(int)>* currentTask = nullptr;
+		int iterationCount = 0;
+		std::atomic<int> nextIteration;
+
+		// Incremented for every loop so that workers notice new loops
+		unsigned long loopGeneration = 0;
+		unsigned int busyWorkers = 0;
+		bool stopping = false;
+};
+
+#endif /* AGENT_THREADPOOL_H_ */
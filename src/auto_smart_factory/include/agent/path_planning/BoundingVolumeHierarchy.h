@@ -0,0 +1,70 @@
+#ifndef PROJECT_BOUNDINGVOLUMEHIERARCHY_H
+#define PROJECT_BOUNDINGVOLUMEHIERARCHY_H
+
+#include <vector>
+
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+#include "agent/path_planning/RectangleBatch.h"
+
+/* Static bounding volume hierarchy over (inflated) rectangles. Built once, used to answer point and line segment queries against all static obstacles without iterating over every obstacle */
+class BoundingVolumeHierarchy {
+private:
+	// Node of the hierarchy. Inner nodes have rectangleCount == 0 and store their children at left and left + 1, leaves store the rectangles [firstRectangle, firstRectangle + rectangleCount)
+	struct Node {
+		double minX;
+		double minY;
+		double maxX;
+		double maxY;
+		int left;
+		int firstRectangle;
+		int rectangleCount;
+	};
+	
+	// Maximum number of rectangles in a leaf, one batch kernel iteration on AVX
+	static const int maxLeafSize = RectangleBatch::laneCount;
+	
+	// Tolerance by which node bounds are enlarged to stay conservative against rounding errors
+	static constexpr double boundsTolerance = 1e-6;
+	
+	// Nodes, the root is at index 0
+	std::vector<Node> nodes;
+	
+	// Rectangles, sorted so that every leaf references a contiguous range
+	RectangleBatch batch;
+	
+public:
+	BoundingVolumeHierarchy() = default;
+	
+	/** Builds the hierarchy
+	 * @param rectangles The rectangles to contain */
+	explicit BoundingVolumeHierarchy(const std::vector<Rectangle>& rectangles);
+	
+	/** Checks whether a point is inside any inflated rectangle
+	 * @param point The point to check
+	 * @return true iff Math::isPointInRectangle is true for any rectangle */
+	bool isPointInAnyRectangle(const Point& point) const;
+
+	/** Checks whether a line segment intersects any inflated rectangle
+	 * @param lStart Line segment start
+	 * @param lEnd Line segment end
+	 * @return true iff Math::doesLineSegmentIntersectRectangle is true for any rectangle */
+	bool doesLineSegmentIntersectAnyRectangle(const Point& lStart, const Point& lEnd) const;
+	
+private:
+	/** Recursively builds the subtree for the rectangles in [first, last) into nodes[nodeIndex]
+	 * @param rectangles All rectangles, reordered during the build
+	 * @param nodeIndex Index of the already allocated node
+	 * @param first First rectangle
+	 * @param last Rectangle behind the last one */
+	void build(std::vector<Rectangle>& rectangles, int nodeIndex, int first, int last);
+	
+	/** Checks whether a line segment intersects the bounds of a node (slab test)
+	 * @param node The node
+	 * @param lStart Line segment start
+	 * @param lEnd Line segment end
+	 * @return true iff the segment touches the bounds */
+	bool doesLineSegmentIntersectBounds(const Node& node, const Point& lStart, const Point& lEnd) const;
+};
+
+#endif //PROJECT_BOUNDINGVOLUMEHIERARCHY_H
@@ -1,17 +1,21 @@
 #ifndef PROTOTYPE_GRIDNODE_HPP
 #define PROTOTYPE_GRIDNODE_HPP
 
-#include <vector>
-
 #include "agent/path_planning/Point.h"
 
-/* Class to hold a theta star grid node data. Contains position and link to neighbours */
+/* Class to hold a theta star grid node data. Contains position and the node id, which indexes the node and its neighbours inside the ThetaStarMap.
+ * Maps hold tens of thousands of nodes per agent, so the position is stored as plain float coordinates instead of a Point */
 class GridNode {
 public:
-	Point pos;
-	std::vector<GridNode*> neighbours;
+	float x;
+	float y;
+	int id;
 
-	explicit GridNode(Point pos);
+	explicit GridNode(Point pos, int id);
+	
+	/** Returns the position of this node
+	 * @return The position */
+	Point getPosition() const;
 };
 
 #endif //PROTOTYPE_GRIDNODE_HPP
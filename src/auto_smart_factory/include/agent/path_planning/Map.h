@@ -2,6 +2,10 @@
 #define PROTOTYPE_MAP_H
 
 #include <vector>
+#include <queue>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
 
 #include "auto_smart_factory/Tray.h"
 #include "auto_smart_factory/WarehouseConfiguration.h"
@@ -12,6 +16,10 @@
 #include "agent/path_planning/OrientedPoint.h"
 #include "agent/path_planning/RobotHardwareProfile.h"
 #include "agent/path_planning/TimedLineOfSightResult.h"
+#include "agent/path_planning/ReservationIndex.h"
+#include "agent/path_planning/BoundingVolumeHierarchy.h"
+#include "agent/path_planning/PathCache.h"
+#include "agent/path_planning/TimedSearchMode.h"
 
 #include "visualization_msgs/Marker.h"
 
@@ -34,8 +42,50 @@ private:
 	// Static obstacles, set in constructor
 	std::vector<Rectangle> obstacles;
 	
-	// Timed reservations, including own reservations
+	// Bounding volume hierarchy over the static obstacles for point and line of sight queries
+	BoundingVolumeHierarchy obstacleHierarchy;
+	
+	// Timed reservations, including own reservations. Deleted reservations leave a free slot so that slots referenced by the reservation index stay valid
 	std::vector<Rectangle> reservations;
+	std::vector<bool> isReservationSlotUsed;
+	std::vector<int> freeReservationSlots;
+	
+	// Unique id of the reservation in each slot. Either assigned on insertion or the id the reservation master assigned, idle reservations get the ids 0 to n-1 in both cases
+	std::vector<unsigned long> reservationIds;
+	unsigned long nextReservationId;
+	
+	// Used slot of each reservation id
+	std::unordered_map<unsigned long, int> reservationSlotsById;
+	
+	// Used slots per reservation owner and the position of each slot inside its owner bucket
+	std::unordered_map<int, std::vector<int>> reservationSlotsByOwner;
+	std::vector<int> ownerBucketPositions;
+	
+	// Min-heap of (end time, slot) for expiry. Entries of already deleted reservations stay until they are popped or the heap is compacted
+	std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> reservationExpiryQueue;
+	int usedReservationSlotCount;
+	
+	// Spatiotemporal index over all used reservation slots
+	ReservationIndex reservationIndex;
+	
+	// Edge length of a reservation index cell
+	static float reservationIndexCellSize;
+	
+	// Incremented whenever reservations are added or deleted, except for the expiry of reservations which already ended
+	unsigned long reservationVersion;
+	
+	// Recently planned paths, reused while the reservations they were planned with did not change. Guarded by the mutex because path queries may run concurrently
+	PathCache pathCache;
+	unsigned long pathCacheHits;
+	unsigned long pathCacheMisses;
+	mutable std::mutex pathCacheMutex;
+	
+	// Search mode used for theta star path queries
+	TimedSearchMode timedSearchMode;
+	
+	// Number of cached paths and duration of a path cache starting time bucket
+	static unsigned long pathCacheCapacity;
+	static double pathCacheStartTimeQuantum;
 	
 	// Theta star map used for theta star path queries
 	ThetaStarMap thetaStarMap;
@@ -82,9 +132,18 @@ public:
 	 * @param pos2 End point
 	 * @param startTime time when the connection starts at the start point
 	 * @param endTime time when the connection is planned to end at the end point
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/ 
-	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const;
+	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const;
+
+	/** Same as whenIsTimedLineOfSightFree, but only checks the timed reservations. Used when the static line of sight is already known to be free
+	 * @param pos1 Start point
+	 * @param pos2 End point
+	 * @param startTime time when the connection starts at the start point
+	 * @param endTime time when the connection is planned to end at the end point
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
+	TimedLineOfSightResult whenIsReservationLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const;
 
 	/** Check if certain line of sight connection is actually free for both driving and waiting during the connection
 	 * @param pos1 Start point
@@ -92,9 +151,16 @@ public:
 	 * @param startTime time when the connection starts at the start point
 	 * @param waitingTime Time to wait at the start point
 	 * @param drivingTime Time to drive from start to end
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
-	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const;
+	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<unsigned long>& smallerReservationIds) const;
+	
+	/** Compute the collision free time intervals of a point. The intervals are sorted and disjoint, the last one is open ended unless the point is blocked forever
+	 * @param pos The point
+	 * @param fromTime Time from which on the intervals are needed
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return List of (start, end) times during which no reservation of another agent contains the point */
+	std::vector<std::pair<double, double>> getSafeIntervals(const Point& pos, double fromTime, const std::vector<unsigned long>& smallerReservationIds) const;
 	
 	/** Checks whether a certain point is in the map 
 	 * @param pos the point to check
@@ -110,12 +176,33 @@ public:
 	 * @param newReservations list of reservations to add */
 	void addReservations(const std::vector<Rectangle>& newReservations);
 	
+	/** Adds reservations with ids assigned by the reservation master
+	 * @param newReservations list of reservations to add
+	 * @param ids id of each reservation */
+	void addReservations(const std::vector<Rectangle>& newReservations, const std::vector<unsigned long>& ids);
+	
+	/** Deletes reservations by id. Ids of reservations which already expired are ignored
+	 * @param ids ids of the reservations to delete
+	 * @return the deleted reservations */
+	std::vector<Rectangle> deleteReservations(const std::vector<unsigned long>& ids);
+	
+	/** Replaces all reservations, used to resynchronize with a snapshot of the reservation master
+	 * @param newReservations all reservations
+	 * @param ids id of each reservation */
+	void replaceAllReservations(const std::vector<Rectangle>& newReservations, const std::vector<unsigned long>& ids);
+	
+	/** Returns all reservations of an agent
+	 * @param agentId the agent id
+	 * @return the reservations in id order */
+	std::vector<Rectangle> getReservationsFromAgent(int agentId) const;
+	
 	/** Delete all reservations which are expired at this time
 	 * @param time the current time */
 	void deleteExpiredReservations(double time);
 	
 	/** Delete all reservations from this agent 
-	 * @param the agent id from which to delete reservations */
+	 * @param the agent id from which to delete reservations
+	 * @return the deleted reservations in insertion order */
 	std::vector<Rectangle> deleteReservationsFromAgent(int agentId);
 		
 	/** Compute a theta star path inside this map. If a OrientedPoint is given, use this point, if a tray is given, compute the approach point in front of this tray and use this point instead
@@ -124,27 +211,79 @@ public:
 	 * @param startingTime The time point when the path should start
 	 * @param targetReservationTime Duration the reservations at the end of the path should last
 	 * @param ignoreStartingReservations Ignore any reservations the start point is inside 
-	 * @return The computed Path. Check path.isValid before using it, errors are returned via an invalid path object */
+	 * @return The computed Path. Check path.isValid before using it, errors are returned via an invalid path object
+	 * Path queries may run concurrently as long as no reservations are added or deleted at the same time */
 	Path getThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations);
 	Path getThetaStarPath(const OrientedPoint& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime);
 	Path getThetaStarPath(const auto_smart_factory::Tray& start, const OrientedPoint& end, double startingTime, double targetReservationTime);
 	Path getThetaStarPath(const auto_smart_factory::Tray& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime);
 	
+	/** Compute a theta star path to whichever of several targets can be reached first, using a single search for all targets. Results are not cached
+	 * @param start start point for the path
+	 * @param targets possible end points for the path
+	 * @param startingTime The time point when the path should start
+	 * @param targetReservationTime Duration the reservations at the end of the path should last
+	 * @param ignoreStartingReservations Ignore any reservations the start point is inside
+	 * @param targetIndex Receives the index of the reached target, -1 if no path was found
+	 * @return The computed Path. Check path.isValid before using it, errors are returned via an invalid path object */
+	Path getThetaStarPathToNearest(const OrientedPoint& start, const std::vector<OrientedPoint>& targets, double startingTime, double targetReservationTime, bool ignoreStartingReservations, int& targetIndex);
+	
+	/** Select how timed reservations are handled by the getThetaStarPath family. Clears the path cache
+	 * @param mode The search mode */
+	void setTimedSearchMode(TimedSearchMode mode);
+	TimedSearchMode getTimedSearchMode() const;
+	
 	/** Checks whether a position is the current target of another robot 
 	 * @param pos The position to check 
 	 * @return True iff the position is the current target of any other robot */
 	bool isPointTargetOfAnotherRobot(OrientedPoint pos);
 	
+	/** Returns the number of path cache hits and misses since construction
+	 * @param hits Number of hits
+	 * @param misses Number of misses */
+	void getPathCacheStatistics(unsigned long& hits, unsigned long& misses) const;
+	
 	// Getter
 	float getWidth() const;
 	float getHeight() const;
 	float getMargin() const;
 	int getOwnerId() const;
+	const std::vector<Rectangle>& getObstacles() const;
 
-	std::vector<Rectangle> getRectanglesOnStartingPoint(Point p) const;
+	/** Returns the ids of all reservations of other agents which contain the specified point
+	 * @param p The point
+	 * @return Sorted list of reservation ids */
+	std::vector<unsigned long> getReservationIdsOnStartingPoint(Point p) const;
 
 private:
-
+	/** Stores a reservation in a free slot and adds it to the reservation index
+	 * @param reservation The reservation to add
+	 * @param id Unique id of the reservation */
+	void addReservation(const Rectangle& reservation, unsigned long id);
+	
+	/** Returns the used slots of an agent
+	 * @param agentId The agent id
+	 * @return The slots in id order */
+	std::vector<int> getReservationSlotsFromAgent(int agentId) const;
+	
+	/** Removes the reservation in this slot from the reservation index and frees the slot. The reservation version is updated by the callers
+	 * @param slot The used slot to free */
+	void deleteReservation(int slot);
+	
+	/** Checks whether the reservation in this slot should be used in its smaller variant
+	 * @param slot The used slot
+	 * @param smallerReservationIds Sorted ids of reservations to use the smaller variant for
+	 * @return true iff the reservation id is in smallerReservationIds */
+	bool isSmallerReservation(int slot, const std::vector<unsigned long>& smallerReservationIds) const;
+	
+	/** Checks whether no reservation intersects any path segment during the whole time the path and its target reservation last
+	 * @param path The path
+	 * @param targetReservationTime Duration of the reservation at the path target
+	 * @return true iff the swept corridor of the path is free */
+	bool isPathCorridorFree(const Path& path, double targetReservationTime) const;
+	
+	/** Rebuilds the expiry queue from the used slots if it contains too many entries of deleted reservations */
+	void compactReservationExpiryQueue();
 };
 
 
@@ -16,6 +16,9 @@ public:
 	//double maxDrivingReservationDuration = 1.75f;
 	double maxDrivingReservationDuration = 2.5f;
 	
+	// Generate a single swept reservation per straight segment or curve instead of one reservation per maxDrivingReservationDuration
+	bool useSweptReservations = false;
+	
 	// Duration Margin a reservations lasts longer than necessary to add safety leeway
 	//double reservationTimeMarginAhead = 0.15f;
 	//double reservationTimeMarginBehind = 0.1f;
@@ -120,7 +123,7 @@ public:
 	visualization_msgs::Marker getVisualizationMsgLines(std_msgs::ColorRGBA color);
 
 private:
-	/** Generate reservations for a straight line segment
+	/** Generate reservations for a straight line segment. One swept reservation if useSweptReservations is set, otherwise one per maxDrivingReservationDuration
 	 * @param reservations The reservations vector to add these reservations to
 	 * @param startPoint Line segment start point
 	 * @param endPoint Line segment end point
@@ -130,7 +133,7 @@ private:
 	 * */
 	void generateReservationsForSegment(std::vector<Rectangle>& reservations, Point startPoint, Point endPoint, double timeAtStartPoint, double deltaDuration, int ownerId) const;
 
-	/** Generate reservations for a curved line segment
+	/** Generate reservations for a curved line segment. One swept reservation if useSweptReservations is set, otherwise one per maxDrivingReservationDuration
 	 * @param reservations The reservations vector to add these reservations to
 	 * @param points List of Points describing the curved line segment
 	 * @param timeAtStartPoint TimeStamp for the start point
@@ -147,6 +150,18 @@ private:
 	 * @param ownerId Owner id for the generated reservations
 	 * */
 	void generateReservationForTray(std::vector<Rectangle>& reservations, OrientedPoint pos, double reservationStartTime, double duration, int ownerId) const;
+	
+	/** Generate a swept reservation for driving straight along a rectangle
+	 * @param reservations The reservations vector to add this reservation to
+	 * @param pos Center of the rectangle
+	 * @param size Size of the rectangle, the x axis is the driving direction
+	 * @param rotation Rotation of the rectangle in degree
+	 * @param distance Distance driven along the rectangle
+	 * @param timeAtStartPoint TimeStamp when driving starts
+	 * @param deltaTime Duration for driving the distance
+	 * @param ownerId Owner id for the generated reservation
+	 * */
+	void generateSweptReservation(std::vector<Rectangle>& reservations, Point pos, Point size, double rotation, double distance, double timeAtStartPoint, double deltaTime, int ownerId) const;
 };
 
 #endif /* AGENT_PATH_H_ */
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef PROJECT_PATHCACHE_H
+#define PROJECT_PATHCACHE_H
+
+#include <list>
+#include <unordered_map>
+
+#include "agent/path_planning/OrientedPoint.h"
+#include "agent/path_planning/Path.h"
+
+/* Least recently used cache for theta star path queries. Entries are keyed by the query and its quantised starting time and remember the reservation version they were planned with.
+ * The cache does not decide whether an entry may be reused, this is up to the map which knows the reservations */
+class PathCache {
+public:
+	/* Parameters of a path query except for the starting time */
+	struct Query {
+		OrientedPoint start;
+		OrientedPoint target;
+		double targetReservationTime;
+		bool ignoreStartingReservations;
+	};
+
+	/* A cached path together with the exact starting time and reservation version it was planned with */
+	struct Entry {
+		double startingTime;
+		unsigned long reservationVersion;
+		Path path;
+	};
+
+	PathCache() = default;
+
+	/** Constructor
+	 * @param capacity Maximum number of cached paths
+	 * @param startTimeQuantum Starting times inside the same multiple of this duration share a cache entry */
+	PathCache(unsigned long capacity, double startTimeQuantum);
+
+	/** Looks up the entry for a query and marks it as most recently used
+	 * @param query The path query
+	 * @param startingTime Starting time of the path query
+	 * @return The cached entry or nullptr. Only valid until the next insert */
+	const Entry* find(const Query& query, double startingTime);
+
+	/** Inserts or replaces the entry for a query. Evicts the least recently used entry if the cache is full
+	 * @param query The path query
+	 * @param startingTime Starting time of the path query
+	 * @param reservationVersion Reservation version the path was planned with
+	 * @param path The planned path */
+	void insert(const Query& query, double startingTime, unsigned long reservationVersion, const Path& path);
+
+	/** Removes all entries */
+	void clear();
+
+private:
+	struct Key {
+		Query query;
+		long startTimeBucket;
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	typedef std::list<std::pair<Key, Entry>> EntryList;
+
+	// Entries ordered from most to least recently used
+	EntryList entries;
+	std::unordered_map<Key, EntryList::iterator, KeyHash> lookup;
+
+	unsigned long capacity = 0;
+	double startTimeQuantum = 1;
+
+	/** Builds the key of a query
+	 * @param query The path query
+	 * @param startingTime Starting time of the path query
+	 * @return The key */
+	Key getKey(const Query& query, double startingTime) const;
+};
+
+#endif //PROJECT_PATHCACHE_H
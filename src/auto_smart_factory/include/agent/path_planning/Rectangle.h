@@ -3,7 +3,9 @@
 
 #include "agent/path_planning/Point.h"
 
-/* Class representing an obstacle or a reservation (which is a timed obstacle). A rotated rectangle is used as geometric representation */
+/* Class representing an obstacle or a reservation (which is a timed obstacle). A rotated rectangle is used as geometric representation.
+ * A swept reservation covers a robot driving along the x axis of the rectangle: The occupied time window moves from the -x end to the +x end of the rectangle.
+ * Its actual shape is the capsule around the center line of the rectangle, the rectangle itself is a conservative bound */
 class Rectangle {
 private:
 	// Center position of the rectangle
@@ -22,6 +24,13 @@ private:
 	// The owner id of the reservation
 	int ownerId;
 	
+	// Time the occupied window needs to move from the start to the end of a swept reservation, 0 for static rectangles
+	double sweepDuration;
+	
+	// Center line end points of a swept reservation
+	Point sweepStart;
+	Point sweepEnd;
+	
 	// ==== Internal data for faster physic processing
 	// Corner points of the inflated rectangle
 	Point pointsInflated[4];
@@ -39,6 +48,10 @@ public:
 	Rectangle(Point pos, Point size, float rotation);
 	Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId);
 	
+	/** Constructor for a swept reservation. The point at the start of the center line is occupied during [startTime, endTime - sweepDuration], the point at its end during [startTime + sweepDuration, endTime]
+	 * @param sweepDuration Time the occupied window needs to move along the rectangle, 0 for a static reservation */
+	Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId, double sweepDuration);
+	
 	// Getter
 	const Point* getPointsInflated() const;
 	const Point* getPointsNonInflated() const;
@@ -57,6 +70,12 @@ public:
 	double getEndTime() const;
 	double getFreeAfter() const;
 	
+	bool getIsSwept() const;
+	double getSweepDuration() const;
+	Point getSweepStart() const;
+	Point getSweepEnd() const;
+	double getSweepRadius() const;
+	
 	/** Checks whether this rectangle overlaps with the specified time range (= time based "collision")
 	 * @param start Start time of the time range
 	 * @param end End time of the time range
@@ -0,0 +1,47 @@
+#ifndef PROJECT_RECTANGLEBATCH_H
+#define PROJECT_RECTANGLEBATCH_H
+
+#include <vector>
+
+#include "agent/path_planning/Rectangle.h"
+
+/* Structure of arrays copy of a list of rectangles, used by the batch intersection kernels in Math.
+ * All arrays are padded to a multiple of laneCount with rectangles which never intersect anything */
+class RectangleBatch {
+public:
+	// Number of rectangles the arrays are padded to (largest supported SIMD width in doubles)
+	static const int laneCount = 4;
+	
+	// Number of (unpadded) rectangles
+	int size;
+	
+	// Inflated bounding box
+	std::vector<double> minX;
+	std::vector<double> minY;
+	std::vector<double> maxX;
+	std::vector<double> maxY;
+	
+	// Inflated corner 0 and the edge vectors corner 0 - corner 1 (ab) and corner 0 - corner 3 (ad) with their squared lengths, used for rotated rectangles
+	std::vector<double> cornerX;
+	std::vector<double> cornerY;
+	std::vector<double> abX;
+	std::vector<double> abY;
+	std::vector<double> adX;
+	std::vector<double> adY;
+	std::vector<double> abLengthSquared;
+	std::vector<double> adLengthSquared;
+	
+	// Is the rectangle axis aligned
+	std::vector<unsigned char> isAxisAligned;
+	
+	// Original rectangles, used as scalar fallback for rotated line segment checks
+	std::vector<Rectangle> rectangles;
+	
+	RectangleBatch();
+	
+	/** Constructor
+	 * @param rectangles The rectangles to copy */
+	explicit RectangleBatch(const std::vector<Rectangle>& rectangles);
+};
+
+#endif //PROJECT_RECTANGLEBATCH_H
@@ -0,0 +1,60 @@
+#ifndef PROJECT_RESERVATIONCODEC_H
+#define PROJECT_RESERVATIONCODEC_H
+
+#include <cstdint>
+#include <vector>
+
+#include "agent/path_planning/Rectangle.h"
+
+/* Compact binary encoding of reservation lists and reservation ids, optionally sent instead of the Rectangle messages.
+ * Coordinates are millimetres relative to the map origin, times are milliseconds relative to the earliest start time of the list and all integers are varints.
+ * Decoded reservations cover the original ones: sizes and end times are rounded up, start times and sweep durations are rounded down */
+class ReservationCodec {
+public:
+	/** Appends a list of reservations
+	 * @param reservations The reservations
+	 * @param bytes Receives the encoded reservations */
+	static void encodeReservations(const std::vector<Rectangle>& reservations, std::vector<uint8_t>& bytes);
+
+	/** Reads a list of reservations written by encodeReservations
+	 * @param bytes The encoded data
+	 * @param offset Position to read from, advanced behind the list
+	 * @param reservations Receives the reservations
+	 * @return False if the data is truncated */
+	static bool decodeReservations(const std::vector<uint8_t>& bytes, int& offset, std::vector<Rectangle>& reservations);
+
+	/** Appends a list of ids, each one stored as difference to its predecessor
+	 * @param ids The ids
+	 * @param bytes Receives the encoded ids */
+	static void encodeIds(const std::vector<unsigned long>& ids, std::vector<uint8_t>& bytes);
+
+	/** Reads a list of ids written by encodeIds
+	 * @param bytes The encoded data
+	 * @param offset Position to read from, advanced behind the list
+	 * @param ids Receives the ids
+	 * @return False if the data is truncated */
+	static bool decodeIds(const std::vector<uint8_t>& bytes, int& offset, std::vector<unsigned long>& ids);
+
+private:
+	// Resolution of coordinates and times
+	static constexpr double unitsPerMeter = 1000.0;
+	static constexpr double unitsPerSecond = 1000.0;
+	
+	// Values within this fraction of a unit count as exact, so that decoded reservations encode to the same data again
+	static constexpr double unitTolerance = 0.01;
+
+	// Rotation code of rectangles whose rotation is no multiple of 90°, followed by the rotation as float
+	static const uint8_t freeRotation = 4;
+
+	// Flag for swept reservations, followed by the sweep duration
+	static const uint8_t sweptFlag = 8;
+
+	static void writeVarint(uint64_t value, std::vector<uint8_t>& bytes);
+	static bool readVarint(const std::vector<uint8_t>& bytes, int& offset, uint64_t& value);
+
+	// Signed values are zigzag encoded so that small negative values stay short
+	static void writeSignedVarint(int64_t value, std::vector<uint8_t>& bytes);
+	static bool readSignedVarint(const std::vector<uint8_t>& bytes, int& offset, int64_t& value);
+};
+
+#endif //PROJECT_RESERVATIONCODEC_H
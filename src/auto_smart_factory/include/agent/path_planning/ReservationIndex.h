@@ -0,0 +1,193 @@
+#ifndef PROJECT_RESERVATIONINDEX_H
+#define PROJECT_RESERVATIONINDEX_H
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "agent/path_planning/Point.h"
+#include "agent/path_planning/Rectangle.h"
+
+/* Spatiotemporal index over timed reservations. The map is divided into a uniform grid, every cell holds the reservations whose inflated bounding box overlaps it together with their time interval.
+ * Line of sight queries only traverse the cells touched by the line segment instead of iterating over all reservations */
+class ReservationIndex {
+public:
+	ReservationIndex() = default;
+	
+	/** Constructor
+	 * @param width Map width
+	 * @param height Map height
+	 * @param cellSize Edge length of a grid cell */
+	ReservationIndex(float width, float height, float cellSize);
+
+	/** Adds a reservation to the index
+	 * @param slot Slot of the reservation in the map's reservation storage
+	 * @param reservation The reservation */
+	void add(int slot, const Rectangle& reservation);
+
+	/** Removes a reservation from the index
+	 * @param slot Slot of the reservation in the map's reservation storage
+	 * @param reservation The reservation, has to be the one added with this slot */
+	void remove(int slot, const Rectangle& reservation);
+
+	/** Calls visitor(slot) for every reservation which shares a grid cell with the line segment and whose time interval overlaps [minEndTime, maxStartTime].
+	 * Reservations are visited at most once per run of consecutive cells, the caller has to tolerate duplicates
+	 * @param lStart Line segment start 
+	 * @param lEnd Line segment end
+	 * @param minEndTime Reservations ending before this time are skipped
+	 * @param maxStartTime Reservations starting after this time are skipped
+	 * @param visitor Callable taking the reservation slot */
+	template<typename Visitor>
+	void forEachCandidate(const Point& lStart, const Point& lEnd, double minEndTime, double maxStartTime, Visitor visitor) const;
+	
+	/** Calls visitor(slot) once for every reservation which shares a grid cell with the axis aligned area and whose time interval overlaps [minEndTime, maxStartTime]
+	 * @param minX Minimum x of the area
+	 * @param minY Minimum y of the area
+	 * @param maxX Maximum x of the area
+	 * @param maxY Maximum y of the area
+	 * @param minEndTime Reservations ending before this time are skipped
+	 * @param maxStartTime Reservations starting after this time are skipped
+	 * @param visitor Callable taking the reservation slot */
+	template<typename Visitor>
+	void forEachCandidateInArea(double minX, double minY, double maxX, double maxY, double minEndTime, double maxStartTime, Visitor visitor) const;
+
+private:
+	// Index entry, the cell range is used to skip reservations which were already visited in the previous cell
+	struct Entry {
+		int slot;
+		double startTime;
+		double endTime;
+		int minCellX;
+		int minCellY;
+		int maxCellX;
+		int maxCellY;
+	};
+	
+	// Edge length of a cell
+	float cellSize;
+	
+	// Number of cells in x and y direction
+	int sizeX;
+	int sizeY;
+	
+	// Cells in row major order (x + y * sizeX)
+	std::vector<std::vector<Entry>> cells;
+
+	/** Returns the cell index of a coordinate. Positions outside of the map are mapped to the border cells
+	 * @param v The coordinate
+	 * @param size Number of cells on this axis
+	 * @return Clamped cell index */
+	int getClampedCell(double v, int size) const;
+	
+	/** Visits all matching entries of a single cell
+	 * @param cellX Cell x (unclamped, from the traversal)
+	 * @param cellY Cell y (unclamped, from the traversal)
+	 * @param prevX Previous traversed cell x, only used if hasPrev
+	 * @param prevY Previous traversed cell y, only used if hasPrev
+	 * @param hasPrev True iff a cell was traversed before this one */
+	template<typename Visitor>
+	void visitCell(int cellX, int cellY, int prevX, int prevY, bool hasPrev, double minEndTime, double maxStartTime, Visitor& visitor) const;
+};
+
+template<typename Visitor>
+void ReservationIndex::visitCell(int cellX, int cellY, int prevX, int prevY, bool hasPrev, double minEndTime, double maxStartTime, Visitor& visitor) const {
+	int x = std::max(0, std::min(sizeX - 1, cellX));
+	int y = std::max(0, std::min(sizeY - 1, cellY));
+	int px = std::max(0, std::min(sizeX - 1, prevX));
+	int py = std::max(0, std::min(sizeY - 1, prevY));
+	
+	for(const Entry& e : cells[x + y * sizeX]) {
+		if(e.endTime < minEndTime || e.startTime > maxStartTime) {
+			continue;
+		}
+		
+		// Already visited in the previous cell
+		if(hasPrev && px >= e.minCellX && px <= e.maxCellX && py >= e.minCellY && py <= e.maxCellY) {
+			continue;
+		}
+		
+		visitor(e.slot);
+	}
+}
+
+template<typename Visitor>
+void ReservationIndex::forEachCandidate(const Point& lStart, const Point& lEnd, double minEndTime, double maxStartTime, Visitor visitor) const {
+	if(cells.empty()) {
+		return;
+	}
+	
+	// Grid traversal (Amanatides & Woo) over the unbounded grid, cells outside of the map are clamped when visited
+	auto cellX = static_cast<int>(std::floor(lStart.x / cellSize));
+	auto cellY = static_cast<int>(std::floor(lStart.y / cellSize));
+	auto endCellX = static_cast<int>(std::floor(lEnd.x / cellSize));
+	auto endCellY = static_cast<int>(std::floor(lEnd.y / cellSize));
+
+	double dx = lEnd.x - lStart.x;
+	double dy = lEnd.y - lStart.y;
+	int stepX = endCellX > cellX ? 1 : -1;
+	int stepY = endCellY > cellY ? 1 : -1;
+	
+	double infinity = std::numeric_limits<double>::max();
+	double tDeltaX = dx != 0 ? cellSize / std::abs(dx) : infinity;
+	double tDeltaY = dy != 0 ? cellSize / std::abs(dy) : infinity;
+	double tMaxX = dx != 0 ? ((cellX + (stepX > 0 ? 1 : 0)) * cellSize - lStart.x) / dx : infinity;
+	double tMaxY = dy != 0 ? ((cellY + (stepY > 0 ? 1 : 0)) * cellSize - lStart.y) / dy : infinity;
+
+	visitCell(cellX, cellY, 0, 0, false, minEndTime, maxStartTime, visitor);
+	
+	while(cellX != endCellX || cellY != endCellY) {
+		int prevX = cellX;
+		int prevY = cellY;
+		bool moveX = cellY == endCellY || (cellX != endCellX && tMaxX <= tMaxY);
+		bool moveY = cellX == endCellX || (cellY != endCellY && tMaxY <= tMaxX);
+		
+		if(moveX && moveY) {
+			// Passing exactly through a cell corner, also visit the cells on both sides
+			visitCell(cellX + stepX, cellY, prevX, prevY, true, minEndTime, maxStartTime, visitor);
+			visitCell(cellX, cellY + stepY, prevX, prevY, true, minEndTime, maxStartTime, visitor);
+		}
+		
+		if(moveX) {
+			cellX += stepX;
+			tMaxX += tDeltaX;
+		}
+		if(moveY) {
+			cellY += stepY;
+			tMaxY += tDeltaY;
+		}
+		
+		visitCell(cellX, cellY, prevX, prevY, true, minEndTime, maxStartTime, visitor);
+	}
+}
+
+template<typename Visitor>
+void ReservationIndex::forEachCandidateInArea(double minX, double minY, double maxX, double maxY, double minEndTime, double maxStartTime, Visitor visitor) const {
+	if(cells.empty()) {
+		return;
+	}
+	
+	int minCellX = getClampedCell(minX, sizeX);
+	int minCellY = getClampedCell(minY, sizeY);
+	int maxCellX = getClampedCell(maxX, sizeX);
+	int maxCellY = getClampedCell(maxY, sizeY);
+	
+	for(int y = minCellY; y <= maxCellY; y++) {
+		for(int x = minCellX; x <= maxCellX; x++) {
+			for(const Entry& e : cells[x + y * sizeX]) {
+				if(e.endTime < minEndTime || e.startTime > maxStartTime) {
+					continue;
+				}
+				
+				// Entries are stored in every cell they overlap, only visit them in the first cell shared with the area
+				if(x != std::max(minCellX, e.minCellX) || y != std::max(minCellY, e.minCellY)) {
+					continue;
+				}
+				
+				visitor(e.slot);
+			}
+		}
+	}
+}
+
+#endif //PROJECT_RESERVATIONINDEX_H
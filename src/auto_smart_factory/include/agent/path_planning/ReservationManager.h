@@ -74,13 +74,34 @@ private:
 	// The times this path has been retrieved
 	int pathRetrievedCount;
 	
-	/** Save the reservations in the message as the last reserved path reservations. These are used to check if the agent is currently inside one of its own reservations 
-	 * @param msg Message contaiing the last reserved reservations */
-	void saveReservationsAsLastReserved(const auto_smart_factory::ReservationBroadcast& msg);
+	// Send reservations in the compact encoding of ReservationCodec. Set with the parameter /compact_reservations
+	bool useCompactReservations;
 	
-	/** Extracts the reservations for a reservation broadcast message
-	 * @param msg The message contaiing the reservations */
-	std::vector<Rectangle> getReservationsFromMessage(const auto_smart_factory::ReservationBroadcast& msg);
+	// Reserve paths with swept reservations, see Path::useSweptReservations. Set with the parameter /swept_reservations
+	bool useSweptReservations;
+	
+	// Version of the reservation master's table the map is up to date with. Sent with every request, so the master can detect reservations which were granted after the path was planned
+	unsigned long knownTableVersion;
+	
+	// Broadcasts were missed and no snapshot was received yet. The map and the own granted reservations are unknown until then
+	bool isResynchronizationPending;
+	
+	// Earliest time of the next snapshot request while a resynchronization is pending
+	double nextResynchronizationTime;
+	
+	// Time between snapshot requests while the reservation master does not answer
+	static constexpr double resynchronizationRetryInterval = 1.0;
+	
+	/** Save the own reservations in the map as the last reserved path reservations. These are used to check if the agent is currently inside one of its own reservations */
+	void saveReservationsAsLastReserved();
+	
+	/** Extracts the reservations from a message
+	 * @param rectangles The reservations of the message */
+	std::vector<Rectangle> getReservationsFromMessage(const std::vector<auto_smart_factory::Rectangle>& rectangles);
+	
+	/** Replaces all reservations in the map with a snapshot of the reservation master. Used when broadcasts were missed
+	 * @return True iff the snapshot was received. Otherwise the resynchronization stays pending and is retried in update */
+	bool resynchronizeReservations();
 	
 	/** Request reservations for the current path */
 	void requestPathReservation();
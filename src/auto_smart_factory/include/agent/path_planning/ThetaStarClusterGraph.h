@@ -0,0 +1,81 @@
+#ifndef PROJECT_THETASTARCLUSTERGRAPH_H
+#define PROJECT_THETASTARCLUSTERGRAPH_H
+
+#include <vector>
+
+#include "agent/path_planning/GridNode.h"
+
+class ThetaStarMap;
+
+/* Abstract graph for hierarchical path planning on large theta star maps. The map is divided into square clusters of grid cells.
+ * Linked nodes on both sides of a cluster border form an entrance, one per contiguous border section. Entrances of the same cluster are connected by
+ * their static shortest path distance inside the cluster. A path query first searches this graph and then only refines the clusters along the abstract path */
+class ThetaStarClusterGraph {
+public:
+	ThetaStarClusterGraph() = default;
+
+	/** Builds the abstract graph from the static node links
+	 * @param map The theta star map. The graph does not keep a reference to it
+	 * @param nodeClusters Cluster of every node, indexed by node id
+	 * @param clusterCount Number of clusters */
+	ThetaStarClusterGraph(const ThetaStarMap& map, std::vector<int> nodeClusters, int clusterCount);
+
+	/** Searches the abstract graph and returns the clusters an abstract path from start to target passes through
+	 * @param map The theta star map the graph was built from
+	 * @param start Start node
+	 * @param target Target node
+	 * @param corridor Receives the ids of the clusters on the abstract path
+	 * @return False if start and target share a cluster or if the target cannot be reached */
+	bool findCorridor(const ThetaStarMap& map, const GridNode* start, const GridNode* target, std::vector<int>& corridor) const;
+
+	/** Returns the cluster of a node
+	 * @param node The node
+	 * @return Cluster id */
+	int getCluster(const GridNode* node) const;
+
+	/** Returns the number of clusters
+	 * @return Cluster count, 0 if the graph has not been built */
+	int getClusterCount() const;
+
+	/** Returns the number of entrance nodes in the abstract graph
+	 * @return Entrance count */
+	int getEntranceCount() const;
+
+private:
+	// Edge of the abstract graph to another entrance
+	struct Edge {
+		int to;
+		float cost;
+	};
+
+	/** Computes the static shortest path distance from a node to all nodes of its own cluster, only using links inside the cluster
+	 * @param map The theta star map
+	 * @param from The node
+	 * @param distances Receives the distances indexed like clusterNodes of the cluster. Unreachable nodes have the distance std::numeric_limits<float>::max() */
+	void getDistancesInCluster(const ThetaStarMap& map, const GridNode* from, std::vector<float>& distances) const;
+
+	/** Returns the entrance of a node, adding a new one if the node is no entrance yet
+	 * @param nodeId Id of the node
+	 * @return Entrance index */
+	int addEntrance(int nodeId);
+
+	// Cluster of every node and index of every node inside clusterNodes of its cluster, both indexed by node id
+	std::vector<int> nodeClusters;
+	std::vector<int> nodeIndicesInCluster;
+
+	// Node ids of every cluster
+	std::vector<std::vector<int>> clusterNodes;
+
+	// Node id of every entrance and entrance index of every node (-1 for nodes which are no entrance)
+	std::vector<int> entranceNodeIds;
+	std::vector<int> nodeEntrances;
+
+	// Entrance indices of every cluster
+	std::vector<std::vector<int>> clusterEntrances;
+
+	// Edges in compressed sparse row layout: The edges of entrance i are edges[edgeOffsets[i]] to edges[edgeOffsets[i + 1] - 1]
+	std::vector<int> edgeOffsets;
+	std::vector<Edge> edges;
+};
+
+#endif //PROJECT_THETASTARCLUSTERGRAPH_H
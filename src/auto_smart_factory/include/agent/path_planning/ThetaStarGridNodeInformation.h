@@ -13,6 +13,12 @@ public:
 	// Waiting time at the previous path node. This is ONLY for reversal path construction
 	double waitTimeAtPrev;
 	
+	// Index of the safe interval of the node this state belongs to. Only used for safe interval path planning
+	int safeInterval;
+	
+	// Position in the ThetaStarOpenList or one of its unvisited/closed markers. Only used for the wait time search
+	int heapIndex;
+	
 	ThetaStarGridNodeInformation(const GridNode* node, ThetaStarGridNodeInformation* prev, double time);
 };
 
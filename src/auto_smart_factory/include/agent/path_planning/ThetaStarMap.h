@@ -1,10 +1,20 @@
 #ifndef PROTOTYPE_THETASTARMAP_HPP
 #define PROTOTYPE_THETASTARMAP_HPP
 
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "Math.h"
+#include "agent/path_planning/BoundingVolumeHierarchy.h"
 #include "agent/path_planning/GridNode.h"
+#include "agent/path_planning/ThetaStarClusterGraph.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
 #include "agent/path_planning/TimedLineOfSightResult.h"
 
 #include "visualization_msgs/Marker.h"
@@ -13,16 +23,132 @@ class Map;
 
 // Collection of Theta* Grid Nodes for Theta* Path Planning
 class ThetaStarMap {
+public:
+	// Range of neighbour ids of a single node, usable in range based for loops. Grid links are decoded from the link mask of the node, explicit links follow behind them
+	class NeighbourIterator {
+	public:
+		NeighbourIterator(const int* cell, const int* cellOffsets, unsigned int gridLinks, const uint32_t* explicitLink) :
+			cell(cell), cellOffsets(cellOffsets), gridLinks(gridLinks), explicitLink(explicitLink) {}
+		
+		int operator*() const {
+			if(gridLinks != 0) {
+				return cell[cellOffsets[__builtin_ctz(gridLinks)]];
+			}
+			return static_cast<int>(*explicitLink);
+		}
+		
+		NeighbourIterator& operator++() {
+			if(gridLinks != 0) {
+				gridLinks &= gridLinks - 1;
+			} else {
+				explicitLink++;
+			}
+			return *this;
+		}
+		
+		bool operator!=(const NeighbourIterator& other) const {
+			return gridLinks != other.gridLinks || explicitLink != other.explicitLink;
+		}
+		
+	private:
+		const int* cell;
+		const int* cellOffsets;
+		unsigned int gridLinks;
+		const uint32_t* explicitLink;
+	};
+	
+	struct NeighbourRange {
+		NeighbourIterator first;
+		NeighbourIterator last;
+
+		NeighbourIterator begin() const { return first; }
+		NeighbourIterator end() const { return last; }
+	};
+
 private:
 	// Pointer to the normal map for line of sight checks
 	Map* map;
 	
-	// Theta* Grid Nodes
-	std::map<Point, GridNode*, Math::PointComparator> nodes;
+	// Theta* Grid Nodes indexed by their id. Regular grid nodes come first, additional nodes are appended behind them
+	std::vector<GridNode> nodes;
+	
+	// Links to the 8 surrounding grid cells, one bit per direction in the order of gridLinkDirections. Only grid nodes have grid links
+	std::vector<uint8_t> gridLinks;
+	
+	// All other links (those from or to additional nodes) in compressed sparse row layout: The explicit neighbours of node i are neighbourIds[neighbourOffsets[i]] to neighbourIds[neighbourOffsets[i + 1] - 1]
+	std::vector<uint32_t> neighbourOffsets;
+	std::vector<uint32_t> neighbourIds;
+	
+	// Dense lookup table from grid cell (ix + iy * gridSizeX) to node id. -1 if there is no node in this cell
+	std::vector<int> gridIndex;
+	int gridSizeX;
+	int gridSizeY;
+	
+	// Cell offsets (dx, dy) of the grid link directions and the same offsets inside gridIndex
+	static const int gridLinkDirections[8][2];
+	int gridLinkCellOffsets[8];
+	
+	// Position of the grid cell (0, 0)
+	Point gridOrigin;
+	
+	// Side table for additional nodes which are not aligned to the grid
+	std::map<Point, int, Math::PointComparator> additionalNodes;
+	
+	// Additional nodes bucketed by their closest grid cell (see getCellKey) for nearest node queries
+	std::unordered_map<int, std::vector<int>> additionalNodesByCell;
 	
 	// Resolution of the Theta* Grid Nodes
 	float resolution;
 	
+	// Caches which are filled by const queries. Path queries may run concurrently, so every member is either atomic or guarded by the mutex.
+	// Kept behind a pointer because atomics and mutexes are not movable
+	struct QueryCaches {
+		// Direct mapped cache for static line of sight results between nodes which are not neighbours. Static obstacles never change, so entries never become stale.
+		// An entry stores (smaller id << 32 | larger id), the highest bit is set iff the line of sight is free
+		std::vector<std::atomic<uint64_t>> visibility;
+		std::atomic<unsigned long> visibilityHits;
+		std::atomic<unsigned long> visibilityMisses;
+		
+		// Lower bounds of the static path length from every node to a landmark node, computed on first use
+		std::unordered_map<int, std::vector<float>> landmarkDistanceTables;
+		std::mutex landmarkDistanceTablesMutex;
+		
+		// Search arenas which are not used by a running path query
+		std::vector<std::unique_ptr<ThetaStarSearchArena>> searchArenas;
+		std::mutex searchArenasMutex;
+	};
+	std::unique_ptr<QueryCaches> caches;
+	
+	// Number of visibility cache entries as power of two
+	static const int visibilityCacheSizeLog2 = 16;
+	
+	// Nodes of frequently used path targets (tray approach points, idle positions)
+	std::unordered_set<int> landmarkNodeIds;
+	
+	// Corners of the inflated static obstacles around the nodes. Shortest paths around the obstacles only bend at these corners
+	std::vector<Point> obstacleCorners;
+	
+	// Corners visible from each corner, checked against the shrunk obstacles
+	std::vector<std::vector<int>> visibleObstacleCorners;
+	
+	// Static obstacles shrunk by obstacleShrinkTolerance. Segments which only touch the obstacles are free against them, so shortest paths along obstacle borders stay visible
+	BoundingVolumeHierarchy shrunkObstacleHierarchy;
+	
+	// Distance by which the obstacles are shrunk for the landmark distance bounds, absorbs rounding errors of the line of sight checks
+	static constexpr float obstacleShrinkTolerance = 1e-3f;
+	
+	// Number of corners checked for visibility per node. Further corners are assumed to be visible, which keeps the bound but makes it less tight
+	static const int maxLandmarkVisibilityChecks = 16;
+	
+	// Abstract graph for hierarchical planning, only built for large maps
+	ThetaStarClusterGraph clusterGraph;
+	
+	// Side length of a cluster of the abstract graph in grid cells
+	static const int clusterSize = 16;
+	
+	// Maps with fewer nodes are searched without the abstract graph
+	static const int minNodeCountForClusterGraph = 5000;
+	
 public:
 	ThetaStarMap() = default;
 	ThetaStarMap(Map* map, float resolution);
@@ -32,9 +158,9 @@ public:
 	 * @param pos2 End point
 	 * @param startTime time when the connection starts at the start point
 	 * @param endTime time when the connection is planned to end at the end point
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
-	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const;
+	TimedLineOfSightResult whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const;
 
 	/** Check if certain line of sight connection is actually free for both driving and waiting during the connection
 	 * @param pos1 Start point
@@ -42,24 +168,112 @@ public:
 	 * @param startTime time when the connection starts at the start point
 	 * @param waitingTime Time to wait at the start point
 	 * @param drivingTime Time to drive from start to end
-	 * @param smallerReservations list of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
 	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
-	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const;
+	bool isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<unsigned long>& smallerReservationIds) const;
 	
-	/** Searches the GridNode closest to the specified position
+	/** Compute if and when a certain line of sight connection between two nodes is free. The static part is answered by the visibility cache
+	 * @param node1 Start node
+	 * @param node2 End node
+	 * @param startTime time when the connection starts at the start node
+	 * @param endTime time when the connection is planned to end at the end node
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return TimedLineOfSighResult. Check @class TimedLineOfSightResult for more info*/
+	TimedLineOfSightResult whenIsTimedLineOfSightFree(const GridNode* node1, double startTime, const GridNode* node2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const;
+	
+	/** Checks whether the static line of sight between two nodes is free. Neighbours are always visible, other pairs are looked up in the visibility cache
+	 * @param node1 Start node
+	 * @param node2 End node
+	 * @return true iff no static obstacle blocks the line of sight */
+	bool isStaticLineOfSightFree(const GridNode* node1, const GridNode* node2) const;
+	
+	/** Returns the number of visibility cache hits and misses since construction
+	 * @param hits Number of hits
+	 * @param misses Number of misses */
+	void getVisibilityCacheStatistics(unsigned long& hits, unsigned long& misses) const;
+	
+	/** Returns the memory used by the visibility cache
+	 * @return Size in bytes */
+	unsigned long getVisibilityCacheMemoryUsage() const;
+	
+	/** Registers the nodes closest to the specified positions as landmarks. Distance tables are only kept for landmarks. Has to be called after all nodes were added, maps which use the cluster graph get no landmarks
+	 * @param positions Positions of frequently used path targets */
+	void addLandmarks(const std::vector<Point>& positions);
+	
+	/** Returns a lower bound of the static path length from every node to the landmark (indexed by node id), built on the first call per landmark.
+	 * The bound is the shortest path around the static obstacles, so it never exceeds a path of line of sight connections between nodes
+	 * @param landmark The landmark node
+	 * @return Distance table, nullptr if the node is no landmark. Nodes which are not linked to the landmark have the distance std::numeric_limits<float>::max(). Stays valid for the lifetime of this map */
+	const std::vector<float>* getLandmarkDistances(const GridNode* landmark) const;
+	
+	/** Takes a search arena for a path query, reusing one of a finished query if possible. Every concurrent query gets its own arena
+	 * @return Arena which has been reset for the current node count. Has to be given back with releaseSearchArena */
+	std::unique_ptr<ThetaStarSearchArena> acquireSearchArena() const;
+	
+	/** Gives back a search arena after the path query is finished so that later queries can reuse it
+	 * @param arena The arena */
+	void releaseSearchArena(std::unique_ptr<ThetaStarSearchArena> arena) const;
+	
+	/** Builds the abstract cluster graph for hierarchical planning if the map is large enough. Has to be called again after nodes were added
+	 * @return True iff the graph was built */
+	bool buildClusterGraph();
+	
+	/** Searches the abstract cluster graph for the clusters a path between two nodes should pass through
+	 * @param start Start node
+	 * @param target Target node
+	 * @param corridor Receives the ids of the clusters on the abstract path
+	 * @return False if there is no cluster graph, if start and target share a cluster or if the target cannot be reached */
+	bool getClusterCorridor(const GridNode* start, const GridNode* target, std::vector<int>& corridor) const;
+	
+	/** Returns the cluster of a node, only valid if the cluster graph was built
+	 * @param node The node
+	 * @return Cluster id */
+	int getCluster(const GridNode* node) const;
+	
+	/** Returns the number of clusters of the abstract cluster graph
+	 * @return Cluster count, 0 if no cluster graph was built */
+	int getClusterCount() const;
+	
+	/** Searches the GridNode closest to the specified position. Snaps the position to the grid and searches rings of cells around it
 	 * @param pos Position to search from 
 	 * @return Closest grid node, nullptr if none could be found */
 	const GridNode* getNodeClosestTo(const Point& pos) const;
 
-	/** Returns a list of rectangles which contain the specified point
+	/** Returns the ids of all reservations of other agents which contain the specified point
 	 * @param p The point
-	 * @return List of rectangles */
-	std::vector<Rectangle> getRectanglesOnStartingPoint(Point p) const;
+	 * @return Sorted list of reservation ids */
+	std::vector<unsigned long> getReservationIdsOnStartingPoint(Point p) const;
+	
+	/** Compute the collision free time intervals of a node, see Map::getSafeIntervals
+	 * @param node The node
+	 * @param fromTime Time from which on the intervals are needed
+	 * @param smallerReservationIds sorted ids of reservations where a smaller variant should be used because the robot starts in these reservations
+	 * @return Sorted list of (start, end) times */
+	std::vector<std::pair<double, double>> getSafeIntervals(const GridNode* node, double fromTime, const std::vector<unsigned long>& smallerReservationIds) const;
 
 	/** Add a new Theta* Grid Node at the specified position and connect it to neighbouring nodes
 	 * @param Pos Position for the new node
 	 * @return True iff a new node was successfully added. Failure reasons include: Position is outside of the map, There already exists a GridNode at this exact position */
 	bool addAdditionalNode(Point pos);
+
+	/** Add multiple new Theta* Grid Nodes. Behaves like calling addAdditionalNode for every position, but rebuilds the neighbour lists only once
+	 * @param positions Positions for the new nodes
+	 * @return Number of positions for which addAdditionalNode would have returned true */
+	int addAdditionalNodes(const std::vector<Point>& positions);
+	
+	/** Returns the node with the specified id
+	 * @param id Node id
+	 * @return The node */
+	const GridNode* getNode(int id) const;
+	
+	/** Returns the ids of all neighbours of the specified node
+	 * @param node The node 
+	 * @return Range of neighbour ids */
+	NeighbourRange getNeighbours(const GridNode* node) const;
+	
+	/** Returns the number of nodes in this map
+	 * @return Node count */
+	int getNodeCount() const;
 	
 	/** Returns the owner if of the theta* Map
 	 * @return Owner Id*/
@@ -71,10 +285,34 @@ public:
 
 
 private:
-	/** Connect the specified Grid Node to the node at the target position
+	/** Connect the specified Grid Node to the grid node in the target cell
 	 * @param node Node to connect 
-	 * @param targetPos Position to look for the node to connect to */
-	void linkToNode(GridNode* node, Point targetPos);
+	 * @param ix X index of the target cell
+	 * @param iy Y index of the target cell
+	 * @return True iff the nodes were linked */
+	bool linkToGridCell(const GridNode& node, int ix, int iy);
+	
+	/** Returns the grid cell index (ix + iy * gridSizeX) of a grid node
+	 * @param node The node, has to be a grid node
+	 * @return The cell index */
+	int getGridCell(const GridNode& node) const;
+	
+	/** Returns the id of the grid node in the specified cell
+	 * @param ix X index of the cell
+	 * @param iy Y index of the cell
+	 * @return Node id, -1 if the cell is outside of the grid or contains no node */
+	int getGridNodeId(int ix, int iy) const;
+	
+	/** Returns the key of the grid cell (ix, iy) for additionalNodesByCell. Valid for cells up to one cell outside of the grid
+	 * @param ix X index of the cell
+	 * @param iy Y index of the cell
+	 * @return The cell key */
+	int getCellKey(int ix, int iy) const;
+
+	/** Searches a node placed at exactly the specified position
+	 * @param pos The position
+	 * @return Node id, -1 if no node exists at this position */
+	int getNodeIdAt(const Point& pos) const;
 };
 
 
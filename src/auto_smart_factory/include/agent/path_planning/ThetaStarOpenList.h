@@ -0,0 +1,76 @@
+#ifndef PROJECT_THETASTAROPENLIST_H
+#define PROJECT_THETASTAROPENLIST_H
+
+#include <utility>
+#include <vector>
+
+#include "agent/path_planning/ThetaStarGridNodeInformation.h"
+
+/* Indexed 4-ary min heap of theta star grid node information, ordered by the key given when a node is pushed.
+ * Every node stores its heap position in heapIndex, so improved nodes are moved inside the heap instead of being pushed again.
+ * Popped nodes are marked as closed until they are pushed again */
+class ThetaStarOpenList {
+public:
+	// heapIndex of nodes which have never been pushed
+	static const int unvisited = -1;
+
+	// heapIndex of nodes which have been popped
+	static const int closed = -2;
+
+	ThetaStarOpenList() = default;
+
+	/** Inserts a node which is not in the open list. Closed nodes are reopened
+	 * @param node The node
+	 * @param key Ordering key of the node */
+	void push(ThetaStarGridNodeInformation* node, double key);
+
+	/** Lowers the key of a node which is in the open list
+	 * @param node The node
+	 * @param key New ordering key, must not be larger than the current one */
+	void decreaseKey(ThetaStarGridNodeInformation* node, double key);
+
+	/** Inserts a node or lowers its key if it is already in the open list. Closed nodes are reopened
+	 * @param node The node
+	 * @param key Ordering key of the node, must not be larger than the current one if the node is in the open list */
+	void update(ThetaStarGridNodeInformation* node, double key);
+
+	/** Returns the node with the smallest key
+	 * @return The node, the open list must not be empty */
+	ThetaStarGridNodeInformation* top() const;
+
+	/** Removes the node with the smallest key and marks it as closed */
+	void pop();
+
+	/** Checks if a node is in the open list
+	 * @param node The node
+	 * @return True iff the node was pushed and not popped since */
+	static bool contains(const ThetaStarGridNodeInformation* node);
+
+	/** Checks if a node was popped and not pushed again since
+	 * @param node The node
+	 * @return True iff the node is closed */
+	static bool isClosed(const ThetaStarGridNodeInformation* node);
+
+	bool empty() const;
+
+	/** Removes all nodes without touching them. Keeps the allocated memory */
+	void clear();
+
+private:
+	static const int arity = 4;
+
+	typedef std::pair<double, ThetaStarGridNodeInformation*> Entry;
+
+	/** Moves the entry at position i towards the root until the heap property holds */
+	void siftUp(int i);
+
+	/** Moves the entry at position i towards the leaves until the heap property holds */
+	void siftDown(int i);
+
+	/** Stores an entry at position i and updates its heap index */
+	void place(int i, const Entry& entry);
+
+	std::vector<Entry> heap;
+};
+
+#endif //PROJECT_THETASTAROPENLIST_H
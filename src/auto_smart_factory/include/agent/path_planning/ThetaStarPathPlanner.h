@@ -1,12 +1,17 @@
 #ifndef PROTOTYPE_THETASTARPATHPLANNER_HPP
 #define PROTOTYPE_THETASTARPATHPLANNER_HPP
 
+#include <deque>
 #include <queue>
+#include <tuple>
+#include <unordered_map>
 
 #include "Math.h"
 #include "agent/path_planning/ThetaStarMap.h"
 #include "agent/path_planning/Path.h"
 #include "agent/path_planning/ThetaStarGridNodeInformation.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
+#include "agent/path_planning/TimedSearchMode.h"
 #include "RobotHardwareProfile.h"
 
 // This class represents a Theta* Path Planner. The search query parameters are specified with the constructor, the path planner is intended to be used only once. A new one needs to be constructed for every path query
@@ -19,10 +24,26 @@ public:
 	 * @param target Target point with orientation
 	 * @param startingTime Start Time of the path
 	 * @param targetReservationTime Duration of the reservations at the path target
-	 * @param ignoreStartingReservations Should reservations at the starting position be ignored? */
-	explicit ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations);
+	 * @param ignoreStartingReservations Should reservations at the starting position be ignored?
+	 * @param mode How timed reservations are handled */
+	explicit ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations, TimedSearchMode mode = TimedSearchMode::WaitTimes);
+	
+	/** Constructor for a path query to whichever of several targets is reached first. A single search is run for all targets
+	 * @param thetaStarMap ThetaStar Mao to search on
+	 * @param hardwareProfile HardwareProfile for the robot the path if for
+	 * @param start Start point with orientation
+	 * @param targets Possible target points with orientation
+	 * @param startingTime Start Time of the path
+	 * @param targetReservationTime Duration of the reservations at the path target
+	 * @param ignoreStartingReservations Should reservations at the starting position be ignored?
+	 * @param mode How timed reservations are handled */
+	explicit ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, const std::vector<OrientedPoint>& targets, double startingTime, double targetReservationTime, bool ignoreStartingReservations, TimedSearchMode mode = TimedSearchMode::WaitTimes);
 	
 	Path findPath();
+	
+	/** Returns which target the path found by findPath leads to
+	 * @return Index into the targets of the constructor, -1 if no path was found */
+	int getReachedTargetIndex() const;
 
 private:
 	// Time value for unexplored Theta* Grid Nodes
@@ -39,17 +60,82 @@ private:
 		}
 	};
 	
-	// Typedef for the Theta* Queue
+	// Typedef for the safe interval search queue
 	typedef std::priority_queue<GridInformationPair, std::vector<GridInformationPair>, GridInformationPairComparator> GridInformationPairQueue;
 	
-	// Typedef for the Theta* Collection of already explored nodes
-	typedef std::map<Point, ThetaStarGridNodeInformation, Math::PointComparator> GridInformationMap;
+	// Collision free (start, end) time interval of a node
+	typedef std::pair<double, double> SafeInterval;
+	
+	// Maximum number of times a single connection is postponed behind blocking reservations before it is given up
+	static const int maxConnectionPostponements = 16;
+
+	/** Theta* search with one state per node, used for TimedSearchMode::WaitTimes. Searches the cluster corridor first if the map has a cluster graph
+	 * @return The found path or an invalid path */
+	Path findPathWithWaitTimes();
+	
+	/** Single Theta* search run of findPathWithWaitTimes
+	 * @param arena Freshly reset arena for the search state, optionally restricted to a cluster corridor
+	 * @return The found path or an invalid path */
+	Path searchWithWaitTimes(ThetaStarSearchArena& arena);
+	
+	/** Single Lazy Theta* search run of findPathWithWaitTimes, used for TimedSearchMode::LazyWaitTimes. Connections are only checked when a node is expanded
+	 * @param arena Freshly reset arena for the search state, optionally restricted to a cluster corridor
+	 * @return The found path or an invalid path */
+	Path searchWithLazyLineOfSight(ThetaStarSearchArena& arena);
+	
+	/** Connects a node whose assumed connection to prev is blocked to the expanded neighbour it can be reached from first, waiting if necessary
+	 * @param arena Arena of the current search
+	 * @param node The node
+	 * @return False if no expanded neighbour can reach the node */
+	bool connectToExpandedNeighbour(ThetaStarSearchArena& arena, ThetaStarGridNodeInformation* node);
+	
+	/** Checks if the line of sight from one node to another is free when driving right away, including the planning uncertainty
+	 * @param from Node to drive from, its time has to be set
+	 * @param to Node to drive to
+	 * @return True iff driving without waiting is possible */
+	bool isConnectionWithoutWaitingPossible(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to) const;
+	
+	/** Like isConnectionWithoutWaitingPossible, but additionally checks that the connection is free for upcoming obstacles
+	 * @param from Node to drive from, its time has to be set
+	 * @param to Node to drive to
+	 * @return True iff the connection can be used without waiting */
+	bool isConnectionWithoutWaitingFree(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to) const;
+	
+	/** Computes how long to wait at one node before the line of sight to another node is free
+	 * @param from Node to drive from, its time has to be set
+	 * @param to Node to drive to
+	 * @param waitingTime Receives the waiting time at from
+	 * @return False if the line of sight is blocked by static obstacles */
+	bool getWaitingTime(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to, double& waitingTime) const;
+	
+	/** Extends the waiting time of a connection which is not free behind the reservation that blocks it
+	 * @param from Node to drive from
+	 * @param to Node to drive to
+	 * @param drivingTime Driving time of the connection
+	 * @param waitingTime Waiting time at from, extended if the connection is blocked by a reservation
+	 * @return True iff the waiting time was extended and the connection should be checked again */
+	bool postponeConnection(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to, double drivingTime, double& waitingTime) const;
+	
+	/** Any-angle Safe Interval Path Planning, used for TimedSearchMode::SafeIntervals
+	 * @return The found path or an invalid path */
+	Path findPathWithSafeIntervals();
+	
+	/** Returns the safe intervals of a node, computed on first use during this query
+	 * @param node The node
+	 * @return Sorted list of safe intervals */
+	const std::vector<SafeInterval>& getSafeIntervals(const GridNode* node);
+	
+	/** Computes the earliest arrival in every safe interval of the neighbour which can be reached by waiting at from and driving straight to the neighbour
+	 * @param from State to depart from
+	 * @param fromIntervalEnd End of the safe interval of from, the departure has to happen before it
+	 * @param neighbour The node to drive to
+	 * @param arrivals Receives (interval index, arrival time, waiting time at from) for every reachable interval */
+	void getSafeIntervalArrivals(ThetaStarGridNodeInformation* from, double fromIntervalEnd, const GridNode* neighbour, std::vector<std::tuple<int, double, double>>& arrivals);
 
-	/** Computes the heuristic for a specific position
+	/** Computes the heuristic for a specific position, the lowest one of all targets
 	 * @param current The current position
-	 * @param targetPos Target position of the current search query
 	 * @return Returns the computed heuristic */
-	double getHeuristic(ThetaStarGridNodeInformation* current, Point targetPos) const;
+	double getHeuristic(ThetaStarGridNodeInformation* current) const;
 	
 	/** Construct the path from the chain of previous pointers after theta* completion
 	 * @param startingTime Starting Time for the path 
@@ -127,14 +213,34 @@ private:
 	// Path start point
 	OrientedPoint start;
 	
-	// Path target point
-	OrientedPoint target;
-	
 	// Used path start node
 	const GridNode* startNode;
 	
-	// Path target node
-	const GridNode* targetNode;
+	// A possible path target
+	struct Goal {
+		// Target point, orientation in degrees
+		OrientedPoint target;
+		
+		// Target node
+		const GridNode* node;
+		
+		// Lower bounds of the static distances to the target node if it is a landmark, nullptr otherwise
+		const std::vector<float>* distances;
+		
+		// Index of the target in the constructor arguments
+		int index;
+	};
+	
+	/** Returns the goal at a node
+	 * @param node The node
+	 * @return The first goal at this node, nullptr if the node is no target */
+	const Goal* getGoal(const GridNode* node) const;
+	
+	// Targets which can be reached from the start node
+	std::vector<Goal> goals;
+	
+	// Goal the found path leads to, nullptr before a path was found
+	const Goal* reachedGoal;
 	
 	// Path starting time offset
 	double startingTime;
@@ -145,8 +251,14 @@ private:
 	// Is this path query valid?
 	bool isValidPathQuery;
 	
-	// List of reservations to ignore/use smaller variant for
-	std::vector<Rectangle> smallerReservations;
+	// Sorted ids of reservations to ignore/use smaller variant for
+	std::vector<unsigned long> smallerReservationIds;
+	
+	// How timed reservations are handled
+	TimedSearchMode mode;
+	
+	// Safe intervals of the nodes touched by a safe interval search, indexed by node id
+	std::unordered_map<int, std::vector<SafeInterval>> safeIntervals;
 };
 
 
@@ -0,0 +1,60 @@
+#ifndef PROJECT_THETASTARSEARCHARENA_H
+#define PROJECT_THETASTARSEARCHARENA_H
+
+#include <vector>
+
+#include "agent/path_planning/GridNode.h"
+#include "agent/path_planning/ThetaStarGridNodeInformation.h"
+#include "agent/path_planning/ThetaStarOpenList.h"
+
+/* Search state of a single theta star path query, stored in flat arrays indexed by node id.
+ * Arenas are kept by the ThetaStarMap and reused for later queries: A generation counter marks which entries belong to the current query, so starting a new query is O(1)
+ * and the arrays only grow when nodes are added to the map */
+class ThetaStarSearchArena {
+public:
+	ThetaStarSearchArena();
+
+	/** Prepares the arena for a new query. Information of previous queries becomes invalid
+	 * @param nodeCount Number of nodes in the map */
+	void reset(int nodeCount);
+
+	/** Returns the information of a node, initialised with no previous node and the specified time on first access during the current query
+	 * @param node The node
+	 * @param initialTime Time of unexplored nodes
+	 * @return Information of the node, stays valid until the next reset */
+	ThetaStarGridNodeInformation* getInformation(const GridNode* node, double initialTime);
+
+	/** Restricts the current query to the nodes of the specified clusters until the next reset
+	 * @param clusters Ids of the allowed clusters
+	 * @param clusterCount Number of clusters in the map */
+	void setCorridor(const std::vector<int>& clusters, int clusterCount);
+
+	/** Checks if the current query is restricted to a corridor
+	 * @return True iff setCorridor was called since the last reset */
+	bool hasCorridor() const;
+
+	/** Checks if a cluster is part of the corridor of the current query
+	 * @param cluster Cluster id
+	 * @return True iff the cluster is part of the corridor, only valid if hasCorridor() is true */
+	bool isInCorridor(int cluster) const;
+
+	/** Returns the open list of the current query
+	 * @return The open list, empty after a reset */
+	ThetaStarOpenList& getOpenList();
+
+private:
+	// Search state indexed by node id. Only valid if the generation of the node matches the current one
+	std::vector<ThetaStarGridNodeInformation> information;
+	std::vector<unsigned int> generations;
+
+	// Generation of the current query
+	unsigned int generation;
+
+	// Clusters of the current corridor are marked with the current generation
+	std::vector<unsigned int> corridorGenerations;
+	bool corridorActive;
+
+	ThetaStarOpenList openList;
+};
+
+#endif //PROJECT_THETASTARSEARCHARENA_H
@@ -0,0 +1,16 @@
+#ifndef PROJECT_TIMEDSEARCHMODE_H
+#define PROJECT_TIMEDSEARCHMODE_H
+
+// How the path planner handles timed reservations
+enum class TimedSearchMode {
+	// One arrival time per node, waiting times are computed per connection from timed line of sight results
+	WaitTimes,
+	
+	// Like WaitTimes, but using Lazy Theta*: Connections to prev are assumed to be free and only checked when a node is expanded
+	LazyWaitTimes,
+	
+	// Safe Interval Path Planning: one search state per node and collision free time interval of that node
+	SafeIntervals
+};
+
+#endif //PROJECT_TIMEDSEARCHMODE_H
@@ -19,6 +19,7 @@
 #include "agent/MotionPlanner.h"
 #include "agent/Gripper.h"
 #include "agent/ChargingManagement.h"
+#include "agent/ThreadPool.h"
 
 class Agent;
 
@@ -225,6 +226,10 @@ class TaskHandler
 		
 		// distance from the current position (in front of a tray) to the targeted tray
 		double lastApproachDistance;
+
+		// Threads planning the candidate paths of an announcement. Several agents share a host, so only a few threads are used per agent. Declared last so that the workers are stopped first
+		static const unsigned int announcementThreadCount = 4;
+		ThreadPool announcementPool;
 };
 
 #endif /* AGENT_TASKHANDLER_H_ */
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_LATENCYHISTOGRAM_H_
+#define AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_LATENCYHISTOGRAM_H_
+
+#include <string>
+#include <vector>
+
+// Histogram of latencies with fixed, roughly logarithmic buckets from 1 ms to 500 ms
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+	
+	/** Adds a latency
+	 * @param latency Latency in seconds */
+	void add(double latency);
+	
+	/** Removes all latencies */
+	void clear();
+	
+	/** Returns the number of added latencies
+	 * @return Latency count */
+	int getCount() const;
+	
+	/** Formats the histogram for logging
+	 * @return One line containing count, mean, max and the non empty buckets */
+	std::string toString() const;
+	
+private:
+	// Upper bounds of the buckets in milliseconds. The last bucket holds everything above the last bound
+	static const std::vector<double> bucketBounds;
+	
+	std::vector<int> bucketCounts;
+	int count;
+	double sum;
+	double max;
+};
+
+#endif /* AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_LATENCYHISTOGRAM_H_ */
@@ -10,6 +10,11 @@
 #include <sstream>
 #include <time.h>
 #include "auto_smart_factory/ReservationRequest.h"
+#include "auto_smart_factory/ReservationBroadcast.h"
+#include "auto_smart_factory/GetReservationSnapshot.h"
+#include "agent/path_planning/Rectangle.h"
+#include "reservation_master/LatencyHistogram.h"
+#include "reservation_master/ReservationTable.h"
 
 class ReservationMaster {
 public:
@@ -17,20 +22,81 @@ public:
 
 	virtual ~ReservationMaster() = default;
 
+	/** Arbitrates the pending requests once the batching window of the first one has passed. Emergency stops are handled without waiting */
 	void update();
+	
+	/** Returns how long to wait for further requests before update has to be called again
+	 * @return Remaining batching window in seconds, idleTimeout if no request is pending */
+	double getTimeUntilUpdate() const;
 
 private:
 	ros::Publisher reservationBroadcastPublisher;
 	ros::Subscriber reservationRequestSubscriber;
+	ros::ServiceServer snapshotService;
 	
 	void reservationRequestCallback(const auto_smart_factory::ReservationRequest& msg);
 	
+	/** Sends the whole reservation table to an agent which missed a reservation broadcast
+	 * @param req Empty request
+	 * @param res Receives the table version and all reservations
+	 * @return Always true */
+	bool snapshotCallback(auto_smart_factory::GetReservationSnapshot::Request& req, auto_smart_factory::GetReservationSnapshot::Response& res);
+	
 	std::vector<auto_smart_factory::ReservationRequest> requests;
 	
+	// Time each pending request was received
+	std::vector<ros::WallTime> requestReceiptTimes;
+	
+	// Requests received within this time after the first pending request are arbitrated together. Set with the private parameter batch_window
+	double batchWindow;
+	
+	// Pending requests are arbitrated at this time
+	ros::WallTime batchDeadline;
+	
+	// Maximum time between two calls of update while no request is pending
+	static constexpr double idleTimeout = 0.1;
+	
+	// All granted reservations
+	ReservationTable reservationTable;
+	
+	/** Grants the pending requests in bid order. A request is granted unless it conflicts with reservations the agent did not know about when planning, including the ones granted before in this round
+	 * @return Indices of the granted requests in bid order */
+	std::vector<int> runAuction();
+	
+	/** Converts the reservations of a request, which may be compact
+	 * @param requestIndex Index of the request
+	 * @param reservations Receives the requested reservations
+	 * @return False if the compact reservations are malformed. Such requests have to be denied */
+	bool getRequestedReservations(int requestIndex, std::vector<Rectangle>& reservations) const;
+	
+	/** Converts a reservation into its message
+	 * @param reservation The reservation
+	 * @return The message */
+	static auto_smart_factory::Rectangle getReservationMessage(const Rectangle& reservation);
+	
 	void sendDenyMessage(int requestIndex);
-	void sendReservationBroadcastMessage(int requestIndex);
-	void sendEmergencyStopBroadcastMessage(int requestIndex);
+	
+	/** Replaces the reservations of the request owner in the reservation table and broadcasts the change
+	 * @param requestIndex Index of the granted request, may be an emergency stop
+	 * @param reservations The requested reservations */
+	void sendReservationBroadcastMessage(int requestIndex, const std::vector<Rectangle>& reservations);
+	
+	/** Publishes a message answering a request and records the latency of the answer
+	 * @param requestIndex Index of the answered request
+	 * @param msg The answer */
+	void publishAnswer(int requestIndex, const auto_smart_factory::ReservationBroadcast& msg);
+	
+	// Auction statistics since the last report
+	int auctionRounds;
+	int grantedRequests;
+	int deniedRequests;
+	
+	// Time from receiving a request to publishing its answer since the last report
+	LatencyHistogram answerLatencies;
+	
+	// Number of auction rounds after which the statistics are reported
+	static const int statisticsReportInterval = 100;
 
 };
 
-#endif /* AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONMASTER_H_ */
\ No newline at end of file
+#endif /* AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONMASTER_H_ */
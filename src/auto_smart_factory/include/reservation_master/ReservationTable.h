@@ -0,0 +1,103 @@
+#ifndef AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONTABLE_H_
+#define AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONTABLE_H_
+
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "agent/path_planning/Rectangle.h"
+#include "agent/path_planning/ReservationIndex.h"
+
+/* Authoritative copy of all granted reservations, kept by the reservation master. Every change increases the table version and every reservation remembers the version it was added in.
+ * Agents send the version they planned with, so conflicts with reservations the agent already knew about are accepted like the agent's own planning did and only races are rejected */
+class ReservationTable {
+public:
+	// Changes of a setReservations call, broadcasted to the agents
+	struct Delta {
+		// Indices of the added reservations into the new reservations. They got consecutive ids starting at firstAddedId
+		std::vector<int> addedIndices;
+		unsigned long firstAddedId;
+		
+		// Sorted ids of the removed reservations
+		std::vector<unsigned long> removedIds;
+	};
+	
+	ReservationTable() = default;
+	
+	/** Constructor
+	 * @param width Map width
+	 * @param height Map height
+	 * @param initialReservations Reservations every agent starts with. They get the ids 0 to n-1 in this order and belong to version 0 */
+	ReservationTable(float width, float height, const std::vector<Rectangle>& initialReservations);
+	
+	/** Checks if reservations conflict with reservations of other owners which were added after a specific version
+	 * @param requestedReservations The reservations to check
+	 * @param ownerId Owner of the reservations
+	 * @param knownVersion Table version the reservations were planned with
+	 * @return True iff no newer reservation of another owner overlaps in space and time */
+	bool isConflictFree(const std::vector<Rectangle>& requestedReservations, int ownerId, unsigned long knownVersion) const;
+	
+	/** Replaces all reservations of an owner and increases the version. Reservations which are unchanged keep their id and version
+	 * @param ownerId The owner
+	 * @param newReservations The new reservations of the owner
+	 * @return The added and removed reservations */
+	Delta setReservations(int ownerId, const std::vector<Rectangle>& newReservations);
+	
+	/** Returns all reservations with their ids, used to resynchronize agents which missed a change
+	 * @param allReservations Receives the reservations in id order
+	 * @param ids Receives the id of each reservation */
+	void getSnapshot(std::vector<Rectangle>& allReservations, std::vector<unsigned long>& ids) const;
+	
+	/** Deletes all reservations which ended before the specified time. Does not change the version because agents delete them on their own
+	 * @param time The time */
+	void deleteExpiredReservations(double time);
+	
+	/** Returns the current version
+	 * @return Version, 0 for an empty table which was never changed */
+	unsigned long getVersion() const;
+	
+	/** Returns the number of stored reservations
+	 * @return Reservation count */
+	int getReservationCount() const;
+	
+private:
+	// Reservations with their owner, id and the version they were added in. Deleted reservations leave a free slot
+	std::vector<Rectangle> reservations;
+	std::vector<int> reservationOwners;
+	std::vector<unsigned long> reservationIds;
+	std::vector<unsigned long> reservationVersions;
+	std::vector<bool> isReservationSlotUsed;
+	std::vector<int> freeReservationSlots;
+	
+	// Used slots per owner
+	std::unordered_map<int, std::vector<int>> reservationSlotsByOwner;
+	
+	// Min-heap of (end time, slot) for expiry. Entries of replaced reservations stay until they are popped
+	std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<std::pair<double, int>>> reservationExpiryQueue;
+	
+	// Spatiotemporal index over all used slots
+	ReservationIndex reservationIndex;
+	
+	// Edge length of a reservation index cell
+	static constexpr float reservationIndexCellSize = 1.f;
+	
+	unsigned long version = 0;
+	unsigned long nextReservationId = 0;
+	int usedReservationSlotCount = 0;
+	
+	/** Stores a reservation in a free slot with the next id and the current version
+	 * @param reservation The reservation
+	 * @param ownerId Owner of the reservation
+	 * @return The used slot */
+	int addReservation(const Rectangle& reservation, int ownerId);
+	
+	/** Removes the reservation in a slot
+	 * @param slot The slot */
+	void deleteReservation(int slot);
+	
+	/** Checks if two reservations are identical
+	 * @return True iff position, size, rotation, times and sweep duration are equal */
+	static bool isSameReservation(const Rectangle& r1, const Rectangle& r2);
+};
+
+#endif /* AUTO_SMART_FACTORY_SRC_RESERVATION_MASTER_RESERVATIONTABLE_H_ */
@@ -1,10 +1,62 @@
+#include <algorithm>
 #include <cmath>
+#include <limits>
 #include <time.h>
 #include <include/Math.h>
 
 
 #include "Math.h"
 #include "agent/path_planning/Point.h"
+#include "agent/path_planning/RectangleBatch.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Thin wrappers around the SIMD instructions used by the batch kernels. min(a, b) = a < b ? a : b and max(a, b) = a > b ? a : b, matching the scalar comparisons
+#if defined(__AVX__)
+	#define MATH_HAS_SIMD_LANES
+	struct SimdLanes {
+		typedef __m256d Vector;
+		static const int count = 4;
+		
+		static Vector load(const double* p) { return _mm256_loadu_pd(p); }
+		static Vector set(double v) { return _mm256_set1_pd(v); }
+		static Vector add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm256_sub_pd(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm256_mul_pd(a, b); }
+		static Vector min(Vector a, Vector b) { return _mm256_min_pd(a, b); }
+		static Vector max(Vector a, Vector b) { return _mm256_max_pd(a, b); }
+		static Vector bitAnd(Vector a, Vector b) { return _mm256_and_pd(a, b); }
+		static Vector lessThan(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+		static Vector notLessThan(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_NLT_UQ); }
+		static Vector notGreaterThan(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_NGT_UQ); }
+		static int mask(Vector a) { return _mm256_movemask_pd(a); }
+	};
+#elif defined(__SSE2__)
+	#define MATH_HAS_SIMD_LANES
+	struct SimdLanes {
+		typedef __m128d Vector;
+		static const int count = 2;
+
+		static Vector load(const double* p) { return _mm_loadu_pd(p); }
+		static Vector set(double v) { return _mm_set1_pd(v); }
+		static Vector add(Vector a, Vector b) { return _mm_add_pd(a, b); }
+		static Vector sub(Vector a, Vector b) { return _mm_sub_pd(a, b); }
+		static Vector mul(Vector a, Vector b) { return _mm_mul_pd(a, b); }
+		static Vector min(Vector a, Vector b) { return _mm_min_pd(a, b); }
+		static Vector max(Vector a, Vector b) { return _mm_max_pd(a, b); }
+		static Vector bitAnd(Vector a, Vector b) { return _mm_and_pd(a, b); }
+		static Vector lessThan(Vector a, Vector b) { return _mm_cmplt_pd(a, b); }
+		static Vector notLessThan(Vector a, Vector b) { return _mm_cmpnlt_pd(a, b); }
+		static Vector notGreaterThan(Vector a, Vector b) { return _mm_cmpngt_pd(a, b); }
+		static int mask(Vector a) { return _mm_movemask_pd(a); }
+	};
+#endif
+}
 
 void Math::initRandom() {
 	initRandom(static_cast<unsigned long>(time(nullptr)));
@@ -139,6 +191,191 @@ double Math::getDistanceToLineSegment(const Point& lStart, const Point& lEnd, co
 		return getDistance(point, lStart + t * line);
 	}
 }
+double Math::getDistanceBetweenLineSegments(const Point& l1Start, const Point& l1End, const Point& l2Start, const Point& l2End) {
+	// Closest points of two segments, see Ericson - Real-Time Collision Detection 5.1.9
+	Point d1 = l1End - l1Start;
+	Point d2 = l2End - l2Start;
+	Point r = l1Start - l2Start;
+	double a = dotProduct(d1, d1);
+	double e = dotProduct(d2, d2);
+	double f = dotProduct(d2, r);
+	double s = 0;
+	double t = 0;
+
+	if(a <= EPS && e <= EPS) {
+		return getDistance(l1Start, l2Start);
+	}
+
+	if(a <= EPS) {
+		t = clamp(f / e, 0, 1);
+	} else {
+		double c = dotProduct(d1, r);
+		if(e <= EPS) {
+			s = clamp(-c / a, 0, 1);
+		} else {
+			double b = dotProduct(d1, d2);
+			double denominator = a * e - b * b;
+			
+			// Parallel segments have no unique closest points, start with an arbitrary one
+			if(denominator > EPS) {
+				s = clamp((b * f - c * e) / denominator, 0, 1);
+			}
+			
+			t = (b * s + f) / e;
+			if(t < 0) {
+				t = 0;
+				s = clamp(-c / a, 0, 1);
+			} else if(t > 1) {
+				t = 1;
+				s = clamp((b - c) / a, 0, 1);
+			}
+		}
+	}
+
+	return getDistance(l1Start + s * d1, l2Start + t * d2);
+}
+
+bool Math::doesLineSegmentIntersectCapsule(const Point& lStart, const Point& lEnd, const Point& cStart, const Point& cEnd, double radius) {
+	return getDistanceBetweenLineSegments(lStart, lEnd, cStart, cEnd) <= radius;
+}
+
+bool Math::getSweptRectangleSection(const Point& lStart, const Point& lEnd, const Rectangle& rectangle, bool inflated, double& sectionStart, double& sectionEnd) {
+	Point centerStart = rectangle.getSweepStart();
+	Point centerEnd = rectangle.getSweepEnd();
+	double radius = rectangle.getSweepRadius() + (inflated ? ROBOT_RADIUS : 0);
+	
+	if(!doesLineSegmentIntersectCapsule(lStart, lEnd, centerStart, centerEnd, radius)) {
+		return false;
+	}
+	
+	double length = getDistance(centerStart, centerEnd);
+	if(length <= EPS) {
+		sectionStart = 0;
+		sectionEnd = 1;
+		return true;
+	}
+	
+	// Center line points within the radius project at most radius away from the projection of the line segment
+	double projection1 = projectPointOnLineSegment(centerStart, centerEnd, lStart);
+	double projection2 = projectPointOnLineSegment(centerStart, centerEnd, lEnd);
+	sectionStart = clamp(std::min(projection1, projection2) - radius / length, 0, 1);
+	sectionEnd = clamp(std::max(projection1, projection2) + radius / length, 0, 1);
+	return true;
+}
+
+bool Math::doesLineSegmentIntersectSweptRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle, double start, double end, bool inflated) {
+	double sectionStart;
+	double sectionEnd;
+	if(!getSweptRectangleSection(lStart, lEnd, rectangle, inflated, sectionStart, sectionEnd)) {
+		return false;
+	}
+	
+	// The point at alpha is occupied during [startTime + alpha * sweepDuration, endTime - (1 - alpha) * sweepDuration]
+	double sweepDuration = rectangle.getSweepDuration();
+	if(sweepDuration > 0) {
+		sectionStart = std::max(sectionStart, 1 - (rectangle.getEndTime() - start) / sweepDuration);
+		sectionEnd = std::min(sectionEnd, (end - rectangle.getStartTime()) / sweepDuration);
+	} else if(start > rectangle.getEndTime() || end < rectangle.getStartTime()) {
+		return false;
+	}
+	
+	if(sectionStart > sectionEnd) {
+		return false;
+	}
+	
+	Point centerLine = rectangle.getSweepEnd() - rectangle.getSweepStart();
+	double radius = rectangle.getSweepRadius() + (inflated ? ROBOT_RADIUS : 0);
+	return doesLineSegmentIntersectCapsule(lStart, lEnd, rectangle.getSweepStart() + sectionStart * centerLine, rectangle.getSweepStart() + sectionEnd * centerLine, radius);
+}
+
+bool Math::isPointInSweptRectangle(const Point& p, const Rectangle& rectangle, double start, double end, bool inflated) {
+	return doesLineSegmentIntersectSweptRectangle(p, p, rectangle, start, end, inflated);
+}
+
+bool Math::getSweptRectangleOccupation(const Point& lStart, const Point& lEnd, const Rectangle& rectangle, bool inflated, double& occupiedFrom, double& occupiedUntil) {
+	double sectionStart;
+	double sectionEnd;
+	if(!getSweptRectangleSection(lStart, lEnd, rectangle, inflated, sectionStart, sectionEnd)) {
+		return false;
+	}
+	
+	occupiedFrom = rectangle.getStartTime() + sectionStart * rectangle.getSweepDuration();
+	occupiedUntil = rectangle.getEndTime() - (1 - sectionEnd) * rectangle.getSweepDuration();
+	return true;
+}
+
+bool Math::getOccupiedSweptSection(const Rectangle& rectangle, double start, double end, Point& sectionStart, Point& sectionEnd) {
+	// The point at alpha is occupied during [startTime + alpha * sweepDuration, endTime - (1 - alpha) * sweepDuration]
+	double sweepDuration = rectangle.getSweepDuration();
+	double alphaStart = clamp(1 - (rectangle.getEndTime() - start) / sweepDuration, 0, 1);
+	double alphaEnd = clamp((end - rectangle.getStartTime()) / sweepDuration, 0, 1);
+	if(alphaStart > alphaEnd || start > rectangle.getEndTime() || end < rectangle.getStartTime()) {
+		return false;
+	}
+	
+	Point centerLine = rectangle.getSweepEnd() - rectangle.getSweepStart();
+	sectionStart = rectangle.getSweepStart() + alphaStart * centerLine;
+	sectionEnd = rectangle.getSweepStart() + alphaEnd * centerLine;
+	return true;
+}
+
+double Math::getDistanceToNonInflatedRectangle(const Point& lStart, const Point& lEnd, const Rectangle& rectangle) {
+	const Point* rect = rectangle.getPointsNonInflated();
+
+	Point ap = rect[0] - lStart;
+	Point ab = rect[0] - rect[1];
+	Point ad = rect[0] - rect[3];
+	if((0 < dotProduct(ap, ab) && dotProduct(ap, ab) < dotProduct(ab, ab)) && (0 < dotProduct(ap, ad) && dotProduct(ap, ad) < dotProduct(ad, ad))) {
+		return 0;
+	}
+
+	double distance = std::numeric_limits<double>::max();
+	for(int i = 0; i < 4; i++) {
+		distance = std::min(distance, getDistanceBetweenLineSegments(lStart, lEnd, rect[i], rect[(i + 1) % 4]));
+	}
+	return distance;
+}
+
+bool Math::doReservationsOverlap(const Rectangle& r1, const Rectangle& r2) {
+	double start = std::max(r1.getStartTime(), r2.getStartTime());
+	double end = std::min(r1.getEndTime(), r2.getEndTime());
+	if(start > end) {
+		return false;
+	}
+	
+	if(!r1.getIsSwept() && !r2.getIsSwept()) {
+		// Either an edge of r1 touches r2 or r2 lies completely inside of r1
+		const Point* points = r1.getPointsNonInflated();
+		for(int i = 0; i < 4; i++) {
+			if(getDistanceToNonInflatedRectangle(points[i], points[(i + 1) % 4], r2) <= 0) {
+				return true;
+			}
+		}
+		
+		Point inner = r2.getPointsNonInflated()[0];
+		return getDistanceToNonInflatedRectangle(inner, inner, r1) <= 0;
+	}
+	
+	// Only the parts of swept rectangles which are occupied while both reservations exist can collide
+	Point section1Start;
+	Point section1End;
+	Point section2Start;
+	Point section2End;
+	if(r1.getIsSwept() && !getOccupiedSweptSection(r1, start, end, section1Start, section1End)) {
+		return false;
+	}
+	if(r2.getIsSwept() && !getOccupiedSweptSection(r2, start, end, section2Start, section2End)) {
+		return false;
+	}
+	
+	if(r1.getIsSwept() && r2.getIsSwept()) {
+		return getDistanceBetweenLineSegments(section1Start, section1End, section2Start, section2End) <= r1.getSweepRadius() + r2.getSweepRadius();
+	} else if(r1.getIsSwept()) {
+		return getDistanceToNonInflatedRectangle(section1Start, section1End, r2) <= r1.getSweepRadius();
+	} else {
+		return getDistanceToNonInflatedRectangle(section2Start, section2End, r1) <= r2.getSweepRadius();
+	}
+}
 
 int Math::getDirectionToLineSegment(const Point& lStart, const Point& lEnd, const Point& point) {
 	Point nEnd = lEnd - lStart;
@@ -355,6 +592,115 @@ bool Math::isPointInNonInflatedRectangle(const Point& p, const Rectangle& rectan
 	return (0 < dotProduct(ap, ab) && dotProduct(ap, ab) < dotProduct(ab, ab)) && (0 < dotProduct(ap, ad) && dotProduct(ap, ad) < dotProduct(ad, ad));
 }
 
+bool Math::doesLineSegmentIntersectAnyRectangle(const Point& lStart, const Point& lEnd, const RectangleBatch& batch, int first, int last) {
+#ifdef MATH_HAS_SIMD_LANES
+	typedef SimdLanes L;
+	
+	// Segment dependent part of doesLineSegmentIntersectAxisAlignedRectangle, shared by all rectangles
+	double segmentMinX = lStart.x;
+	double segmentMaxX = lEnd.x;
+	if(lStart.x > lEnd.x) {
+		segmentMinX = lEnd.x;
+		segmentMaxX = lStart.x;
+	}
+	
+	double dx = lEnd.x - lStart.x;
+	bool useSlope = std::abs(dx) > EPS;
+	double slope = useSlope ? (lEnd.y - lStart.y) / dx : 0;
+	double offset = useSlope ? lStart.y - slope * lStart.x : 0;
+	
+	L::Vector segMinX = L::set(segmentMinX);
+	L::Vector segMaxX = L::set(segmentMaxX);
+	L::Vector a = L::set(slope);
+	L::Vector b = L::set(offset);
+	
+	for(int i = first; i < last; i += L::count) {
+		// Intersection of the x-projections
+		L::Vector minX = L::max(L::load(&batch.minX[i]), segMinX);
+		L::Vector maxX = L::min(L::load(&batch.maxX[i]), segMaxX);
+		L::Vector overlapX = L::notGreaterThan(minX, maxX);
+		
+		// Corresponding y-projection of the segment
+		L::Vector minY = useSlope ? L::add(L::mul(a, minX), b) : L::set(lStart.y);
+		L::Vector maxY = useSlope ? L::add(L::mul(a, maxX), b) : L::set(lEnd.y);
+		L::Vector sortedMinY = L::min(maxY, minY);
+		L::Vector sortedMaxY = L::max(minY, maxY);
+		
+		// Intersection of the y-projections
+		sortedMaxY = L::min(L::load(&batch.maxY[i]), sortedMaxY);
+		sortedMinY = L::max(L::load(&batch.minY[i]), sortedMinY);
+		int hits = L::mask(L::bitAnd(overlapX, L::notGreaterThan(sortedMinY, sortedMaxY)));
+		
+		for(int lane = 0; lane < L::count && i + lane < last; lane++) {
+			if(batch.isAxisAligned[i + lane]) {
+				if((hits >> lane) & 1) {
+					return true;
+				}
+			} else if(doesLineSegmentIntersectNonAxisAlignedRectangle(lStart, lEnd, batch.rectangles[i + lane])) {
+				return true;
+			}
+		}
+	}
+	
+	return false;
+#else
+	for(int i = first; i < last; i++) {
+		if(doesLineSegmentIntersectRectangle(lStart, lEnd, batch.rectangles[i])) {
+			return true;
+		}
+	}
+	
+	return false;
+#endif
+}
+
+bool Math::isPointInAnyRectangle(const Point& p, const RectangleBatch& batch, int first, int last) {
+#ifdef MATH_HAS_SIMD_LANES
+	typedef SimdLanes L;
+
+	L::Vector px = L::set(p.x);
+	L::Vector py = L::set(p.y);
+	L::Vector zero = L::set(0);
+	
+	for(int i = first; i < last; i += L::count) {
+		// Same checks as isPointInAxisAlignedRectangle
+		L::Vector inBounds = L::bitAnd(
+				L::bitAnd(L::notLessThan(px, L::load(&batch.minX[i])), L::notGreaterThan(px, L::load(&batch.maxX[i]))),
+				L::bitAnd(L::notLessThan(py, L::load(&batch.minY[i])), L::notGreaterThan(py, L::load(&batch.maxY[i]))));
+		int inBoundsMask = L::mask(inBounds);
+		if(inBoundsMask == 0) {
+			continue;
+		}
+		
+		// Same checks as the rotated part of isPointInRectangle
+		L::Vector apX = L::sub(L::load(&batch.cornerX[i]), px);
+		L::Vector apY = L::sub(L::load(&batch.cornerY[i]), py);
+		L::Vector apDotAb = L::add(L::mul(apX, L::load(&batch.abX[i])), L::mul(apY, L::load(&batch.abY[i])));
+		L::Vector apDotAd = L::add(L::mul(apX, L::load(&batch.adX[i])), L::mul(apY, L::load(&batch.adY[i])));
+		L::Vector inRotated = L::bitAnd(
+				L::bitAnd(L::lessThan(zero, apDotAb), L::lessThan(apDotAb, L::load(&batch.abLengthSquared[i]))),
+				L::bitAnd(L::lessThan(zero, apDotAd), L::lessThan(apDotAd, L::load(&batch.adLengthSquared[i]))));
+		int inRotatedMask = L::mask(inRotated);
+		
+		for(int lane = 0; lane < L::count && i + lane < last; lane++) {
+			if(((inBoundsMask >> lane) & 1) && (batch.isAxisAligned[i + lane] || ((inRotatedMask >> lane) & 1))) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+#else
+	for(int i = first; i < last; i++) {
+		if(isPointInRectangle(p, batch.rectangles[i])) {
+			return true;
+		}
+	}
+
+	return false;
+#endif
+}
+
 bool Math::isPointInAxisAlignedRectangle(const Point& p, const Rectangle& rectangle) {
 	return !(p.x < rectangle.getMinXInflated() || p.x > rectangle.getMaxXInflated() ||
 	         p.y < rectangle.getMinYInflated() || p.y > rectangle.getMaxYInflated());
@@ -33,27 +33,31 @@ void ChargingManagement::getAllChargingStations(){
 
 std::pair<Path, uint32_t> ChargingManagement::getPathToNearestChargingStation(OrientedPoint start, double startingTime) {
 	u_int32_t nearestStationId = 0;
-	Path shortestPath;
-	double nearestStationDuration = 99999;
 	
-	//Find paths for all possible charging stations
+	// Approach points of all charging stations which are not targeted by another robot
+	std::vector<OrientedPoint> approachPoints;
+	std::vector<u_int32_t> approachPointStationIds;
 	for(auto& charging_tray : charging_trays) {
-		if(map->isPointTargetOfAnotherRobot(map->getPointInFrontOfTray(charging_tray))) {
+		OrientedPoint approachPoint = map->getPointInFrontOfTray(charging_tray);
+		if(map->isPointTargetOfAnotherRobot(approachPoint)) {
 			continue;
-		}		
-		
-		Path path = map->getThetaStarPath(start, map->getPointInFrontOfTray(charging_tray), startingTime, ChargingTask::getChargingTime(), true);
-		if(path.isValid() && path.getDuration() < nearestStationDuration) {
-			nearestStationDuration = path.getDuration();
-			
-			shortestPath = path;
-			nearestStationId = charging_tray.id;
 		}
+		
+		approachPoints.push_back(approachPoint);
+		approachPointStationIds.push_back(charging_tray.id);
+	}
+	
+	// A single search to all of them, the first station reached is the nearest one
+	int approachPointIndex = -1;
+	Path shortestPath;
+	if(!approachPoints.empty()) {
+		shortestPath = map->getThetaStarPathToNearest(start, approachPoints, startingTime, ChargingTask::getChargingTime(), true, approachPointIndex);
 	}
 	
-	if(!shortestPath.isValid()) {
+	if(shortestPath.isValid()) {
+		nearestStationId = approachPointStationIds[approachPointIndex];
+	} else {
 		int rand = static_cast<int>(std::floor(Math::getRandom(0, charging_trays.size() - 1)));
-		Path path = map->getThetaStarPath(start, map->getPointInFrontOfTray(charging_trays[rand]), startingTime, ChargingTask::getChargingTime(), true);
 		nearestStationId = charging_trays[rand].id;
 	}
 	
@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include "agent/ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	nextIteration(0)
+{
+	if(threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// The calling thread is one of the loop threads
+	for(unsigned int i = 1; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	loopStarted.notify_all();
+
+	for(std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+	if(workers.empty() || count <= 1) {
+		for(int i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentTask = &task;
+		iterationCount = count;
+		nextIteration.store(0);
+		busyWorkers = static_cast<unsigned int>(workers.size());
+		loopGeneration++;
+	}
+	loopStarted.notify_all();
+
+	runIterations();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	loopFinished.wait(lock, [this] { return busyWorkers == 0; });
+	currentTask = nullptr;
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+	return static_cast<unsigned int>(workers.size()) + 1;
+}
+
+void ThreadPool::workerLoop() {
+	unsigned long seenGeneration = 0;
+
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			loopStarted.wait(lock, [&] { return stopping || loopGeneration != seenGeneration; });
+			if(stopping) {
+				return;
+			}
+			seenGeneration = loopGeneration;
+		}
+
+		runIterations();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if(--busyWorkers == 0) {
+			loopFinished.notify_one();
+		}
+	}
+}
+
+void ThreadPool::runIterations() {
+	int i;
+	while((i = nextIteration.fetch_add(1)) < iterationCount) {
+		(*currentTask)(i);
+	}
+}
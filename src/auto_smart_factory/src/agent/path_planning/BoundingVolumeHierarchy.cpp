@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "agent/path_planning/BoundingVolumeHierarchy.h"
+#include "Math.h"
+
+constexpr double BoundingVolumeHierarchy::boundsTolerance;
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(const std::vector<Rectangle>& rectangles) {
+	if(rectangles.empty()) {
+		return;
+	}
+	
+	std::vector<Rectangle> sortedRectangles = rectangles;
+	nodes.reserve(rectangles.size() * 2);
+	nodes.emplace_back();
+	build(sortedRectangles, 0, 0, static_cast<int>(sortedRectangles.size()));
+	
+	batch = RectangleBatch(sortedRectangles);
+}
+
+void BoundingVolumeHierarchy::build(std::vector<Rectangle>& rectangles, int nodeIndex, int first, int last) {
+	Node node;
+	node.minX = std::numeric_limits<double>::max();
+	node.minY = std::numeric_limits<double>::max();
+	node.maxX = std::numeric_limits<double>::lowest();
+	node.maxY = std::numeric_limits<double>::lowest();
+	
+	for(int i = first; i < last; i++) {
+		node.minX = std::min(node.minX, rectangles[i].getMinXInflated());
+		node.minY = std::min(node.minY, rectangles[i].getMinYInflated());
+		node.maxX = std::max(node.maxX, rectangles[i].getMaxXInflated());
+		node.maxY = std::max(node.maxY, rectangles[i].getMaxYInflated());
+	}
+	node.minX -= boundsTolerance;
+	node.minY -= boundsTolerance;
+	node.maxX += boundsTolerance;
+	node.maxY += boundsTolerance;
+
+	if(last - first <= maxLeafSize) {
+		node.left = -1;
+		node.firstRectangle = first;
+		node.rectangleCount = last - first;
+		nodes[nodeIndex] = node;
+		return;
+	}
+	
+	// Median split along the longer axis of the node bounds
+	bool splitX = node.maxX - node.minX >= node.maxY - node.minY;
+	int middle = first + (last - first) / 2;
+	std::nth_element(rectangles.begin() + first, rectangles.begin() + middle, rectangles.begin() + last, [splitX](const Rectangle& a, const Rectangle& b) {
+		if(splitX) {
+			return a.getMinXInflated() + a.getMaxXInflated() < b.getMinXInflated() + b.getMaxXInflated();
+		} else {
+			return a.getMinYInflated() + a.getMaxYInflated() < b.getMinYInflated() + b.getMaxYInflated();
+		}
+	});
+	
+	node.left = static_cast<int>(nodes.size());
+	node.firstRectangle = 0;
+	node.rectangleCount = 0;
+	nodes[nodeIndex] = node;
+	
+	nodes.emplace_back();
+	nodes.emplace_back();
+	build(rectangles, node.left, first, middle);
+	build(rectangles, node.left + 1, middle, last);
+}
+
+bool BoundingVolumeHierarchy::isPointInAnyRectangle(const Point& point) const {
+	if(nodes.empty()) {
+		return false;
+	}
+	
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	
+	while(stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		if(point.x < node.minX || point.x > node.maxX || point.y < node.minY || point.y > node.maxY) {
+			continue;
+		}
+		
+		if(node.rectangleCount > 0) {
+			if(Math::isPointInAnyRectangle(point, batch, node.firstRectangle, node.firstRectangle + node.rectangleCount)) {
+				return true;
+			}
+		} else {
+			stack[stackSize++] = node.left;
+			stack[stackSize++] = node.left + 1;
+		}
+	}
+	
+	return false;
+}
+
+bool BoundingVolumeHierarchy::doesLineSegmentIntersectAnyRectangle(const Point& lStart, const Point& lEnd) const {
+	if(nodes.empty()) {
+		return false;
+	}
+
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while(stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		if(!doesLineSegmentIntersectBounds(node, lStart, lEnd)) {
+			continue;
+		}
+
+		if(node.rectangleCount > 0) {
+			if(Math::doesLineSegmentIntersectAnyRectangle(lStart, lEnd, batch, node.firstRectangle, node.firstRectangle + node.rectangleCount)) {
+				return true;
+			}
+		} else {
+			stack[stackSize++] = node.left;
+			stack[stackSize++] = node.left + 1;
+		}
+	}
+
+	return false;
+}
+
+bool BoundingVolumeHierarchy::doesLineSegmentIntersectBounds(const Node& node, const Point& lStart, const Point& lEnd) const {
+	double tMin = 0;
+	double tMax = 1;
+	
+	double d[2] = {lEnd.x - lStart.x, lEnd.y - lStart.y};
+	double o[2] = {lStart.x, lStart.y};
+	double minBounds[2] = {node.minX, node.minY};
+	double maxBounds[2] = {node.maxX, node.maxY};
+	
+	for(int axis = 0; axis < 2; axis++) {
+		if(d[axis] == 0) {
+			if(o[axis] < minBounds[axis] || o[axis] > maxBounds[axis]) {
+				return false;
+			}
+		} else {
+			double t1 = (minBounds[axis] - o[axis]) / d[axis];
+			double t2 = (maxBounds[axis] - o[axis]) / d[axis];
+			tMin = std::max(tMin, std::min(t1, t2));
+			tMax = std::min(tMax, std::max(t1, t2));
+			
+			if(tMin > tMax) {
+				return false;
+			}
+		}
+	}
+	
+	return true;
+}
@@ -1,5 +1,11 @@
 #include "agent/path_planning/GridNode.h"
 
-GridNode::GridNode(Point pos) : 
-	pos(pos) {
+GridNode::GridNode(Point pos, int id) : 
+	x(static_cast<float>(pos.x)),
+	y(static_cast<float>(pos.y)),
+	id(id) {
+}
+
+Point GridNode::getPosition() const {
+	return Point(x, y);
 }
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <iostream>
 #include <include/agent/path_planning/Map.h>
@@ -9,6 +10,9 @@
 
 int Map::visualisationId = 0;
 double Map::infiniteReservationTime = 0;
+float Map::reservationIndexCellSize = 1.f;
+unsigned long Map::pathCacheCapacity = 1024;
+double Map::pathCacheStartTimeQuantum = 1.0;
 
 Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector<Rectangle>& obstacles, RobotHardwareProfile* hardwareProfile, int ownerId) :
 		warehouseConfig(warehouseConfig),
@@ -26,15 +30,42 @@ Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector
 	for(const Rectangle& o : obstacles) {
 		this->obstacles.emplace_back(o.getPosition(), o.getSize(), o.getRotation());
 	}
+	obstacleHierarchy = BoundingVolumeHierarchy(this->obstacles);
 	
 	// Theta star map
 	thetaStarMap = ThetaStarMap(this, warehouseConfig.map_configuration.resolutionThetaStar);
+	std::vector<Point> trayApproachPoints;
 	for(const auto& tray : warehouseConfig.trays) {
 		OrientedPoint p = getPointInFrontOfTray(tray);
-		thetaStarMap.addAdditionalNode(Point(p.x, p.y));
+		trayApproachPoints.emplace_back(p.x, p.y);
 	}
+	thetaStarMap.addAdditionalNodes(trayApproachPoints);
+	
+	// Tray approach points and idle positions are the common path targets, use them as landmarks for the theta star heuristic
+	std::vector<Point> landmarks = trayApproachPoints;
+	for(const auto& idlePosition : warehouseConfig.idle_positions) {
+		landmarks.emplace_back(idlePosition.pose.x, idlePosition.pose.y);
+	}
+	thetaStarMap.addLandmarks(landmarks);
+	thetaStarMap.buildClusterGraph();
 	
 	reservations.clear();
+	isReservationSlotUsed.clear();
+	freeReservationSlots.clear();
+	reservationIds.clear();
+	nextReservationId = 0;
+	reservationSlotsById.clear();
+	reservationSlotsByOwner.clear();
+	ownerBucketPositions.clear();
+	reservationExpiryQueue = decltype(reservationExpiryQueue)();
+	usedReservationSlotCount = 0;
+	reservationIndex = ReservationIndex(width, height, reservationIndexCellSize);
+	reservationVersion = 0;
+	
+	timedSearchMode = TimedSearchMode::WaitTimes;
+	pathCache = PathCache(pathCacheCapacity, pathCacheStartTimeQuantum);
+	pathCacheHits = 0;
+	pathCacheMisses = 0;
 	
 	// Add idle reservations
 	double infiniteReservationStartTime = ros::Time::now().toSec() - 1000;
@@ -43,43 +74,68 @@ Map::Map(auto_smart_factory::WarehouseConfiguration warehouseConfig, std::vector
 		int id = std::stoi(idStr);
 		Point pos = Point(static_cast<float>(idlePosition.pose.x), static_cast<float>(idlePosition.pose.y));
 		
-		reservations.emplace_back(pos, Point(Path::getReservationSize(), Path::getReservationSize()), 0, infiniteReservationStartTime, infiniteReservationTime, id);
+		addReservation(Rectangle(pos, Point(Path::getReservationSize(), Path::getReservationSize()), 0, infiniteReservationStartTime, infiniteReservationTime, id), nextReservationId);
 	}
 }
 
 bool Map::isInsideAnyStaticInflatedObstacle(const Point& point) const {
-	for(const Rectangle& obstacle : obstacles) {
-		if(Math::isPointInRectangle(point, obstacle)) {
-			return true;
-		}
-	}
-
-	return false;
+	return obstacleHierarchy.isPointInAnyRectangle(point);
 }
 
 bool Map::isStaticLineOfSightFree(const Point& pos1, const Point& pos2) const {
-	for(const Rectangle& obstacle : obstacles) {
-		if(Math::doesLineSegmentIntersectRectangle(pos1, pos2, obstacle)) {
-			return false;
-		}
-	}
+	return !obstacleHierarchy.doesLineSegmentIntersectAnyRectangle(pos1, pos2);
+}
 
-	return true;
+TimedLineOfSightResult Map::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const {
+	if(!isStaticLineOfSightFree(pos1, pos2)) {
+		TimedLineOfSightResult result;
+		result.blockedByStatic = true;
+		return result;
+	}
+	
+	return whenIsReservationLineOfSightFree(pos1, startTime, pos2, endTime, smallerReservationIds);
 }
 
-TimedLineOfSightResult Map::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const {
+TimedLineOfSightResult Map::whenIsReservationLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const {
 	// Todo make adaptive - for now assume that every reservation can be left in x seconds
 	double minTimeToLeave = 5;
 	
 	TimedLineOfSightResult result;
-
-	if(!isStaticLineOfSightFree(pos1, pos2)) {
-		result.blockedByStatic = true;
-		return result;
-	}
 	
-	for(const Rectangle& reservation : reservations) {
-		if(std::find(smallerReservations.begin(), smallerReservations.end(), reservation) != smallerReservations.end()) {
+	// Reservations ending before this time can neither block the connection nor be an upcoming obstacle
+	double minEndTime = std::min(startTime + 0.01f, endTime);
+	
+	reservationIndex.forEachCandidate(pos1, pos2, minEndTime, std::numeric_limits<double>::max(), [&](int slot) {
+		const Rectangle& reservation = reservations[slot];
+		
+		if(reservation.getIsSwept()) {
+			// Like doesLineSegmentIntersectNonInflatedRectangle, the smaller variant never blocks a connection
+			if(reservation.getOwnerId() == ownerId || isSmallerReservation(slot, smallerReservationIds)) {
+				return;
+			}
+			
+			double occupiedFrom;
+			double occupiedUntil;
+			
+			// Directly blocked until the robot has passed the touched part
+			if(Math::doesLineSegmentIntersectSweptRectangle(pos1, pos2, reservation, startTime + 0.01f, endTime, true) && Math::getSweptRectangleOccupation(pos1, pos2, reservation, true, occupiedFrom, occupiedUntil)) {
+				result.blockedByTimed = true;
+				if(occupiedUntil > result.freeAfter) {
+					result.freeAfter = occupiedUntil;
+				}
+			}
+			
+			// Upcoming obstacles
+			if(Math::getSweptRectangleOccupation(pos2, pos2, reservation, true, occupiedFrom, occupiedUntil) && occupiedFrom > endTime) {
+				result.hasUpcomingObstacle = true;
+				
+				double lastValidEntryTime = occupiedFrom - minTimeToLeave;
+				if(lastValidEntryTime < result.lastValidEntryTime) {
+					result.lastValidEntryTime = lastValidEntryTime;
+					result.freeAfterUpcomingObstacle = occupiedUntil;
+				}
+			}
+		} else if(isSmallerReservation(slot, smallerReservationIds)) {
 			// Directly blocked
 			if(reservation.doesOverlapTimeRange(startTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectNonInflatedRectangle(pos1, pos2, reservation)) {
 				result.blockedByTimed = true;
@@ -118,7 +174,7 @@ TimedLineOfSightResult Map::whenIsTimedLineOfSightFree(const Point& pos1, double
 				}
 			}	
 		}		
-	}
+	});
 	
 	// Treat "infinite" obstacles as completely blocked and dont wait forever
 	double maxTime = endTime + 1000.f;
@@ -130,35 +186,67 @@ TimedLineOfSightResult Map::whenIsTimedLineOfSightFree(const Point& pos1, double
 	return result;
 }
 
-bool Map::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const {
+bool Map::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<unsigned long>& smallerReservationIds) const {
 	// Does not check against static obstacles, this is only used to verify a already planned connection
 	double endTime = startTime + waitingTime + drivingTime;
+	bool isFree = true;
 
-	for(const Rectangle& reservation : reservations) {
-		if(std::find(smallerReservations.begin(), smallerReservations.end(), reservation) != smallerReservations.end()) {
+	reservationIndex.forEachCandidate(pos1, pos2, startTime, endTime, [&](int slot) {
+		const Rectangle& reservation = reservations[slot];
+		
+		if(!isFree) {
+			return;
+		}
+		
+		if(reservation.getIsSwept()) {
+			// Check if the waiting and the driving part are free. Like the non-inflated checks, the smaller variant never blocks them
+			if(reservation.getOwnerId() != ownerId && !isSmallerReservation(slot, smallerReservationIds) &&
+			   (Math::isPointInSweptRectangle(pos1, reservation, startTime, startTime + waitingTime - 0.01f, true) ||
+			    Math::doesLineSegmentIntersectSweptRectangle(pos1, pos2, reservation, startTime + waitingTime + 0.01f, endTime, true))) {
+				isFree = false;
+			}
+		} else if(isSmallerReservation(slot, smallerReservationIds)) {
 			// Check if the waiting part is free
 			if(reservation.doesOverlapTimeRange(startTime, startTime + waitingTime - 0.01f, ownerId) && Math::isPointInNonInflatedRectangle(pos1, reservation)) {
-				return false;
+				isFree = false;
 			}
 
 			// Check if the driving part is free
 			if(reservation.doesOverlapTimeRange(startTime + waitingTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectNonInflatedRectangle(pos1, pos2, reservation)) {
-				return false;
+				isFree = false;
 			}
 		} else {
 			// Check if the waiting part is free
 			if(reservation.doesOverlapTimeRange(startTime, startTime + waitingTime - 0.01f, ownerId) && Math::isPointInRectangle(pos1, reservation)) {
-				return false;
+				isFree = false;
 			}
 
 			// Check if the driving part is free
 			if(reservation.doesOverlapTimeRange(startTime + waitingTime + 0.01f, endTime, ownerId) && Math::doesLineSegmentIntersectRectangle(pos1, pos2, reservation)) {
-				return false;
+				isFree = false;
 			}	
 		}		
+	});
+
+	return isFree;
+}
+
+void Map::setTimedSearchMode(TimedSearchMode mode) {
+	std::lock_guard<std::mutex> lock(pathCacheMutex);
+	if(mode != timedSearchMode) {
+		timedSearchMode = mode;
+		pathCache.clear();
 	}
+}
 
-	return true;
+TimedSearchMode Map::getTimedSearchMode() const {
+	return timedSearchMode;
+}
+
+void Map::getPathCacheStatistics(unsigned long& hits, unsigned long& misses) const {
+	std::lock_guard<std::mutex> lock(pathCacheMutex);
+	hits = pathCacheHits;
+	misses = pathCacheMisses;
 }
 
 float Map::getWidth() const {
@@ -173,37 +261,124 @@ float Map::getMargin() const {
 	return margin;
 }
 
+const std::vector<Rectangle>& Map::getObstacles() const {
+	return obstacles;
+}
+
 Path Map::getThetaStarPath(const OrientedPoint& start, const OrientedPoint& end, double startingTime, double targetReservationTime, bool ignoreStartingReservations) {
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, end, startingTime, targetReservationTime, ignoreStartingReservations);
-	return thetaStarPathPlanner.findPath();
+	PathCache::Query query{start, end, targetReservationTime, ignoreStartingReservations};
+	
+	{
+		std::lock_guard<std::mutex> lock(pathCacheMutex);
+		const PathCache::Entry* entry = pathCache.find(query, startingTime);
+		
+		if(entry != nullptr && entry->reservationVersion == reservationVersion) {
+			if(entry->startingTime == startingTime) {
+				pathCacheHits++;
+				return entry->path;
+			}
+			
+			// Paths without waiting times do not depend on the exact starting time as long as no reservation gets in the way
+			if(entry->path.isValid()) {
+				const std::vector<double>& waitTimes = entry->path.getWaitTimes();
+				if(std::all_of(waitTimes.begin(), waitTimes.end(), [](double w) { return w == 0; })) {
+					Path shiftedPath(startingTime, entry->path.getNodes(), waitTimes, hardwareProfile, targetReservationTime, entry->path.getStart(), entry->path.getEnd(), ownerId);
+					if(isPathCorridorFree(shiftedPath, targetReservationTime)) {
+						pathCacheHits++;
+						return shiftedPath;
+					}
+				}
+			}
+		}
+		pathCacheMisses++;
+	}
+	
+	// Planned without holding the lock, concurrent queries only share the read only map and the thread safe theta star map caches
+	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, end, startingTime, targetReservationTime, ignoreStartingReservations, timedSearchMode);
+	Path path = thetaStarPathPlanner.findPath();
+	
+	std::lock_guard<std::mutex> lock(pathCacheMutex);
+	pathCache.insert(query, startingTime, reservationVersion, path);
+	
+	return path;
 }
 
 Path Map::getThetaStarPath(const OrientedPoint& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime) {
 	const OrientedPoint endPoint = getPointInFrontOfTray(end);
 	
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, endPoint, startingTime, targetReservationTime, false);
 	//ROS_INFO("Computing path from (%f/%f) to tray of type %s (%f/%f)", start.x, start.y, end.type.c_str(), getPointInFrontOfTray(end).x, getPointInFrontOfTray(end).y);
 	
-	return thetaStarPathPlanner.findPath();
+	return getThetaStarPath(start, endPoint, startingTime, targetReservationTime, false);
 }
 
 Path Map::getThetaStarPath(const auto_smart_factory::Tray& start, const OrientedPoint& end, double startingTime, double targetReservationTime) {
 	const OrientedPoint startPoint = getPointInFrontOfTray(start);
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, startPoint, end, startingTime, targetReservationTime, false);
 	
 	//ROS_INFO("Computing path from tray of type %s (%f/%f) to (%f/%f)", start.type.c_str(), getPointInFrontOfTray(start).x, getPointInFrontOfTray(start).y, end.x, end.y);
 	
-	return thetaStarPathPlanner.findPath();
+	return getThetaStarPath(startPoint, end, startingTime, targetReservationTime, false);
 }
 
 Path Map::getThetaStarPath(const auto_smart_factory::Tray& start, const auto_smart_factory::Tray& end, double startingTime, double targetReservationTime) {
 	const OrientedPoint startPoint = getPointInFrontOfTray(start);
 	const OrientedPoint endPoint = getPointInFrontOfTray(end);
 
-	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, startPoint, endPoint, startingTime, targetReservationTime, false);
 	//ROS_INFO("Computing path from tray of type %s (%f/%f) to tray of type %s (%f/%f)", start.type.c_str(), getPointInFrontOfTray(start).x, getPointInFrontOfTray(start).y, end.type.c_str(), getPointInFrontOfTray(end).x, getPointInFrontOfTray(end).y);
 	
-	return thetaStarPathPlanner.findPath();
+	return getThetaStarPath(startPoint, endPoint, startingTime, targetReservationTime, false);
+}
+
+Path Map::getThetaStarPathToNearest(const OrientedPoint& start, const std::vector<OrientedPoint>& targets, double startingTime, double targetReservationTime, bool ignoreStartingReservations, int& targetIndex) {
+	ThetaStarPathPlanner thetaStarPathPlanner(&thetaStarMap, hardwareProfile, start, targets, startingTime, targetReservationTime, ignoreStartingReservations, timedSearchMode);
+	Path path = thetaStarPathPlanner.findPath();
+	targetIndex = path.isValid() ? thetaStarPathPlanner.getReachedTargetIndex() : -1;
+	
+	return path;
+}
+
+std::vector<std::pair<double, double>> Map::getSafeIntervals(const Point& pos, double fromTime, const std::vector<unsigned long>& smallerReservationIds) const {
+	std::vector<std::pair<double, double>> blockedIntervals;
+	
+	// A single point only touches one index cell, so every reservation is visited once
+	reservationIndex.forEachCandidate(pos, pos, fromTime, std::numeric_limits<double>::max(), [&](int slot) {
+		const Rectangle& reservation = reservations[slot];
+		if(reservation.getOwnerId() == ownerId) {
+			return;
+		}
+		
+		// Swept reservations only block the point while the occupied window passes it. Like isPointInNonInflatedRectangle, points are never inside the smaller variant
+		if(reservation.getIsSwept()) {
+			double occupiedFrom;
+			double occupiedUntil;
+			if(!isSmallerReservation(slot, smallerReservationIds) && Math::getSweptRectangleOccupation(pos, pos, reservation, true, occupiedFrom, occupiedUntil)) {
+				blockedIntervals.emplace_back(occupiedFrom, occupiedUntil);
+			}
+			return;
+		}
+		
+		bool containsPoint = isSmallerReservation(slot, smallerReservationIds) ? Math::isPointInNonInflatedRectangle(pos, reservation) : Math::isPointInRectangle(pos, reservation);
+		if(containsPoint) {
+			blockedIntervals.emplace_back(reservation.getStartTime(), reservation.getEndTime());
+		}
+	});
+	std::sort(blockedIntervals.begin(), blockedIntervals.end());
+	
+	// Complement of the blocked intervals
+	std::vector<std::pair<double, double>> safeIntervals;
+	double freeFrom = fromTime;
+	for(const auto& blocked : blockedIntervals) {
+		if(blocked.first > freeFrom) {
+			safeIntervals.emplace_back(freeFrom, blocked.first);
+		}
+		freeFrom = std::max(freeFrom, blocked.second);
+	}
+	
+	// Points inside "infinite" reservations never become free again
+	if(freeFrom < infiniteReservationTime) {
+		safeIntervals.emplace_back(freeFrom, std::numeric_limits<double>::max());
+	}
+	
+	return safeIntervals;
 }
 
 bool Map::isPointInMap(const Point& pos) const {
@@ -211,39 +386,186 @@ bool Map::isPointInMap(const Point& pos) const {
 }
 
 void Map::deleteExpiredReservations(double time) {
-	auto iter = reservations.begin();
-
-	while(iter != reservations.end()) {
-		if((*iter).getEndTime() < time) {
-			iter = reservations.erase(iter);
-		} else {
-			iter++;
+	while(!reservationExpiryQueue.empty() && reservationExpiryQueue.top().first < time) {
+		int slot = reservationExpiryQueue.top().second;
+		reservationExpiryQueue.pop();
+		
+		// The slot may have been freed or reused since this entry was pushed
+		if(isReservationSlotUsed[slot] && reservations[slot].getEndTime() < time) {
+			deleteReservation(slot);
 		}
 	}
+	
+	// The reservation version is kept. Reservations which already ended cannot affect paths starting now or later, so cached paths stay reusable
 }
 
 std::vector<Rectangle> Map::deleteReservationsFromAgent(int agentId) {
 	std::vector<Rectangle> deletedReservations;
-	auto iter = reservations.begin();
-
-	while(iter != reservations.end()) {
-		if((*iter).getOwnerId() == agentId) {
-			deletedReservations.push_back(*iter);
-			iter = reservations.erase(iter);
-		} else {
-			iter++;
-		}
+	
+	// Return in insertion order
+	std::vector<int> slots = getReservationSlotsFromAgent(agentId);
+	
+	deletedReservations.reserve(slots.size());
+	for(int slot : slots) {
+		deletedReservations.push_back(reservations[slot]);
+		deleteReservation(slot);
 	}
 	
+	if(!deletedReservations.empty()) {
+		reservationVersion++;
+	}
+	compactReservationExpiryQueue();
+	
 	return deletedReservations;
 }
 
 void Map::addReservations(const std::vector<Rectangle>& newReservations) {
 	for(const auto& r : newReservations) {
-		reservations.emplace_back(r.getPosition(), r.getSize(), r.getRotation(), r.getStartTime(), r.getEndTime(), r.getOwnerId());
+		addReservation(Rectangle(r.getPosition(), r.getSize(), r.getRotation(), r.getStartTime(), r.getEndTime(), r.getOwnerId(), r.getSweepDuration()), nextReservationId);
 	}
 }
 
+void Map::addReservations(const std::vector<Rectangle>& newReservations, const std::vector<unsigned long>& ids) {
+	for(int i = 0; i < newReservations.size(); i++) {
+		const Rectangle& r = newReservations[i];
+		addReservation(Rectangle(r.getPosition(), r.getSize(), r.getRotation(), r.getStartTime(), r.getEndTime(), r.getOwnerId(), r.getSweepDuration()), ids[i]);
+	}
+}
+
+std::vector<Rectangle> Map::deleteReservations(const std::vector<unsigned long>& ids) {
+	std::vector<Rectangle> deletedReservations;
+	
+	for(unsigned long id : ids) {
+		auto slot = reservationSlotsById.find(id);
+		if(slot != reservationSlotsById.end()) {
+			deletedReservations.push_back(reservations[slot->second]);
+			deleteReservation(slot->second);
+		}
+	}
+	
+	if(!deletedReservations.empty()) {
+		reservationVersion++;
+	}
+	compactReservationExpiryQueue();
+	
+	return deletedReservations;
+}
+
+void Map::replaceAllReservations(const std::vector<Rectangle>& newReservations, const std::vector<unsigned long>& ids) {
+	for(int slot = 0; slot < static_cast<int>(reservations.size()); slot++) {
+		if(isReservationSlotUsed[slot]) {
+			deleteReservation(slot);
+		}
+	}
+	reservationExpiryQueue = decltype(reservationExpiryQueue)();
+	reservationVersion++;
+	
+	addReservations(newReservations, ids);
+}
+
+std::vector<Rectangle> Map::getReservationsFromAgent(int agentId) const {
+	std::vector<Rectangle> agentReservations;
+	for(int slot : getReservationSlotsFromAgent(agentId)) {
+		agentReservations.push_back(reservations[slot]);
+	}
+	
+	return agentReservations;
+}
+
+std::vector<int> Map::getReservationSlotsFromAgent(int agentId) const {
+	auto bucket = reservationSlotsByOwner.find(agentId);
+	if(bucket == reservationSlotsByOwner.end()) {
+		return std::vector<int>();
+	}
+	
+	std::vector<int> slots = bucket->second;
+	std::sort(slots.begin(), slots.end(), [&](int a, int b) {
+		return reservationIds[a] < reservationIds[b];
+	});
+	
+	return slots;
+}
+
+void Map::addReservation(const Rectangle& reservation, unsigned long id) {
+	int slot;
+	
+	if(freeReservationSlots.empty()) {
+		slot = static_cast<int>(reservations.size());
+		reservations.push_back(reservation);
+		isReservationSlotUsed.push_back(true);
+		reservationIds.push_back(id);
+		ownerBucketPositions.push_back(0);
+	} else {
+		slot = freeReservationSlots.back();
+		freeReservationSlots.pop_back();
+		reservations[slot] = reservation;
+		isReservationSlotUsed[slot] = true;
+		reservationIds[slot] = id;
+	}
+	usedReservationSlotCount++;
+	reservationSlotsById[id] = slot;
+	nextReservationId = std::max(nextReservationId, id + 1);
+	
+	std::vector<int>& bucket = reservationSlotsByOwner[reservation.getOwnerId()];
+	ownerBucketPositions[slot] = static_cast<int>(bucket.size());
+	bucket.push_back(slot);
+	
+	reservationExpiryQueue.emplace(reservation.getEndTime(), slot);
+	reservationIndex.add(slot, reservation);
+	reservationVersion++;
+}
+
+void Map::deleteReservation(int slot) {
+	reservationIndex.remove(slot, reservations[slot]);
+	
+	// Swap with the last slot of the owner bucket
+	std::vector<int>& bucket = reservationSlotsByOwner[reservations[slot].getOwnerId()];
+	int position = ownerBucketPositions[slot];
+	bucket[position] = bucket.back();
+	ownerBucketPositions[bucket[position]] = position;
+	bucket.pop_back();
+	
+	isReservationSlotUsed[slot] = false;
+	freeReservationSlots.push_back(slot);
+	reservationSlotsById.erase(reservationIds[slot]);
+	usedReservationSlotCount--;
+}
+
+bool Map::isPathCorridorFree(const Path& path, double targetReservationTime) const {
+	double windowStart = path.getStartTimeOffset() - path.reservationTimeMarginBehind;
+	double windowEnd = path.getStartTimeOffset() + path.getDuration() + targetReservationTime + path.reservationTimeMarginAhead;
+	
+	const std::vector<Point>& nodes = path.getNodes();
+	std::vector<unsigned long> noSmallerReservations;
+	for(unsigned long i = 0; i + 1 < nodes.size(); i++) {
+		if(!isTimedConnectionFree(nodes[i], nodes[i + 1], windowStart, 0, windowEnd - windowStart, noSmallerReservations)) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+void Map::compactReservationExpiryQueue() {
+	if(reservationExpiryQueue.size() <= 2 * static_cast<unsigned long>(usedReservationSlotCount) + 64) {
+		return;
+	}
+	
+	std::vector<std::pair<double, int>> entries;
+	entries.reserve(static_cast<unsigned long>(usedReservationSlotCount));
+	for(int slot = 0; slot < static_cast<int>(reservations.size()); slot++) {
+		if(isReservationSlotUsed[slot]) {
+			entries.emplace_back(reservations[slot].getEndTime(), slot);
+		}
+	}
+	
+	reservationExpiryQueue = decltype(reservationExpiryQueue)(std::greater<std::pair<double, int>>(), std::move(entries));
+}
+
+bool Map::isSmallerReservation(int slot, const std::vector<unsigned long>& smallerReservationIds) const {
+	return !smallerReservationIds.empty() && std::binary_search(smallerReservationIds.begin(), smallerReservationIds.end(), reservationIds[slot]);
+}
+
 OrientedPoint Map::getPointInFrontOfTray(const auto_smart_factory::Tray& tray) {
 	OrientedPoint p;
 
@@ -340,8 +662,9 @@ visualization_msgs::Marker Map::getInactiveReservationVisualization(visualizatio
 	p.z = 0.f;
 
 	double now = ros::Time::now().toSec();
-	for(const Rectangle& reservation : reservations) {
-		if(reservation.getOwnerId() != ownerId) {
+	for(int slot = 0; slot < static_cast<int>(reservations.size()); slot++) {
+		const Rectangle& reservation = reservations[slot];
+		if(!isReservationSlotUsed[slot] || reservation.getOwnerId() != ownerId) {
 			continue;
 		}
 		
@@ -409,8 +732,9 @@ visualization_msgs::Marker Map::getActiveReservationVisualization(visualization_
 	p.z = 0.f;
 
 	double now = ros::Time::now().toSec();
-	for(const Rectangle& reservation : reservations) {
-		if(reservation.getOwnerId() != ownerId) {
+	for(int slot = 0; slot < static_cast<int>(reservations.size()); slot++) {
+		const Rectangle& reservation = reservations[slot];
+		if(!isReservationSlotUsed[slot] || reservation.getOwnerId() != ownerId) {
 			continue;
 		}
 
@@ -464,27 +788,34 @@ visualization_msgs::Marker Map::getLinkVisualization() {
 }
 
 bool Map::isPointTargetOfAnotherRobot(OrientedPoint p) {
-	for(const auto& r : reservations) {
-		if(Math::isPointInRectangle(Point(p.x, p.y), r) && r.getOwnerId() != ownerId && r.getEndTime() - r.getStartTime() >= 150.f) {
-			return true;
-		}		
-	}
+	Point pos(p.x, p.y);
+	bool isTarget = false;
+	
+	reservationIndex.forEachCandidate(pos, pos, -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), [&](int slot) {
+		const Rectangle& r = reservations[slot];
+		if(!r.getIsSwept() && Math::isPointInRectangle(pos, r) && r.getOwnerId() != ownerId && r.getEndTime() - r.getStartTime() >= 150.f) {
+			isTarget = true;
+		}
+	});
 	
-	return false;
+	return isTarget;
 }
 
 int Map::getOwnerId() const {
 	return ownerId;
 }
 
-std::vector<Rectangle> Map::getRectanglesOnStartingPoint(Point p) const {
-	std::vector<Rectangle> rectangles;
+std::vector<unsigned long> Map::getReservationIdsOnStartingPoint(Point p) const {
+	std::vector<unsigned long> ids;
 
-	for(const auto& r : reservations) {
+	// A single point only touches one index cell, so every reservation is visited once
+	reservationIndex.forEachCandidate(p, p, -std::numeric_limits<double>::max(), std::numeric_limits<double>::max(), [&](int slot) {
+		const Rectangle& r = reservations[slot];
 		if(Math::isPointInRectangle(p, r) && r.getOwnerId() != ownerId) {
-			rectangles.push_back(r);
+			ids.push_back(reservationIds[slot]);
 		}
-	}
+	});
 	
-	return rectangles;
+	std::sort(ids.begin(), ids.end());
+	return ids;
 }
@@ -1,5 +1,6 @@
 #include <utility>
 #include <cmath>
+#include <algorithm>
 
 #include "Math.h"
 #include "ros/ros.h"
@@ -157,6 +158,11 @@ void Path::generateReservationsForSegment(std::vector<Rectangle>& reservations,
 	Point normalizedDir = (endPoint - startPoint) * (1.f/distance);
 	double rotation = Math::getRotationInDeg(normalizedDir);
 	
+	if(useSweptReservations) {
+		generateSweptReservation(reservations, (startPoint + endPoint) / 2.f, Point(distance + getReservationSize(), getReservationSize()), rotation, distance, timeAtStartPoint, deltaTime, ownerId);
+		return;
+	}
+	
 	auto segmentCount = static_cast<unsigned int>(std::ceil(deltaTime / maxDrivingReservationDuration));
 	double deltaDuration = deltaTime / static_cast<double>(segmentCount);
 	double deltaDistance = distance / static_cast<double>(segmentCount);
@@ -188,6 +194,20 @@ void Path::generateReservationsForCurvePoints(std::vector<Rectangle>& reservatio
 	Point widthDirection = (points.at(static_cast<unsigned long>(std::floor((points.size() - 1) / 2))) - halfDistance) * 0.5f;
 	double widthOffset = Math::getLength(widthDirection) * 2.f;
 	
+	if(useSweptReservations) {
+		// The center line is the full chord moved halfway towards the curve, its radius covers the robot at every curve point
+		Point pos = halfDistance + widthDirection;
+		Point halfChord = normalizedDir * (distance * 0.5f);
+		double curveDistance = 0;
+		for(const Point& p : points) {
+			curveDistance = std::max(curveDistance, Math::getDistanceToLineSegment(pos - halfChord, pos + halfChord, p));
+		}
+		double radius = getReservationSize() * 0.5f + curveDistance;
+		
+		generateSweptReservation(reservations, pos, Point(distance + radius * 2.f, radius * 2.f), rotation, distance, timeAtStartPoint, deltaTime, ownerId);
+		return;
+	}
+	
 	// Split into multiple segments
 	auto segmentCount = static_cast<unsigned int>(std::ceil(deltaTime / maxDrivingReservationDuration));
 	double deltaDuration = deltaTime / static_cast<double>(segmentCount);
@@ -232,6 +252,19 @@ void Path::generateReservationForTray(std::vector<Rectangle>& reservations, Orie
 	reservations.emplace_back(center, Point(length, width), Math::toDeg(pos.o), startTime, endTime, ownerId);
 }
 
+void Path::generateSweptReservation(std::vector<Rectangle>& reservations, Point pos, Point size, double rotation, double distance, double timeAtStartPoint, double deltaTime, int ownerId) const {
+	double timeAtEndPoint = timeAtStartPoint + deltaTime;
+	
+	// The driving time includes turning, so the robot may be behind or ahead of a constant speed by this much
+	double turningTime = std::max(0.0, deltaTime - hardwareProfile->getDrivingDuration(distance));
+	
+	// The uncertainty grows over time, the one at the end point covers the whole segment
+	double startTime = timeAtStartPoint - turningTime - timing.getReservationUncertainty(timeAtEndPoint, Direction::BEHIND) - reservationTimeMarginBehind;
+	double endTime = timeAtEndPoint + turningTime + timing.getReservationUncertainty(timeAtEndPoint, Direction::AHEAD) + reservationTimeMarginAhead;
+	
+	reservations.emplace_back(pos, size, rotation, startTime, endTime, ownerId, deltaTime);
+}
+
 const std::vector<Point>& Path::getNodes() const {
 	ROS_ASSERT(isValidPath);
 	return nodes;
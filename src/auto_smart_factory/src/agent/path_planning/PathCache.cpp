@@ -0,0 +1,67 @@
+#include <cmath>
+#include <functional>
+
+#include "agent/path_planning/PathCache.h"
+
+PathCache::PathCache(unsigned long capacity, double startTimeQuantum) :
+	capacity(capacity),
+	startTimeQuantum(startTimeQuantum)
+{
+	lookup.reserve(capacity);
+}
+
+const PathCache::Entry* PathCache::find(const Query& query, double startingTime) {
+	auto it = lookup.find(getKey(query, startingTime));
+	if(it == lookup.end()) {
+		return nullptr;
+	}
+
+	entries.splice(entries.begin(), entries, it->second);
+	return &it->second->second;
+}
+
+void PathCache::insert(const Query& query, double startingTime, unsigned long reservationVersion, const Path& path) {
+	if(capacity == 0) {
+		return;
+	}
+
+	Key key = getKey(query, startingTime);
+	auto it = lookup.find(key);
+	if(it != lookup.end()) {
+		entries.erase(it->second);
+		lookup.erase(it);
+	} else if(lookup.size() >= capacity) {
+		lookup.erase(entries.back().first);
+		entries.pop_back();
+	}
+
+	entries.emplace_front(key, Entry{startingTime, reservationVersion, path});
+	lookup.emplace(key, entries.begin());
+}
+
+void PathCache::clear() {
+	entries.clear();
+	lookup.clear();
+}
+
+PathCache::Key PathCache::getKey(const Query& query, double startingTime) const {
+	return Key{query, static_cast<long>(std::floor(startingTime / startTimeQuantum))};
+}
+
+bool PathCache::Key::operator==(const Key& other) const {
+	return query.start.x == other.query.start.x && query.start.y == other.query.start.y && query.start.o == other.query.start.o
+		&& query.target.x == other.query.target.x && query.target.y == other.query.target.y && query.target.o == other.query.target.o
+		&& query.targetReservationTime == other.query.targetReservationTime && query.ignoreStartingReservations == other.query.ignoreStartingReservations
+		&& startTimeBucket == other.startTimeBucket;
+}
+
+size_t PathCache::KeyHash::operator()(const Key& key) const {
+	std::hash<double> hashDouble;
+	size_t hash = std::hash<long>()(key.startTimeBucket);
+
+	for(double v : {key.query.start.x, key.query.start.y, key.query.start.o, key.query.target.x, key.query.target.y, key.query.target.o, key.query.targetReservationTime}) {
+		hash ^= hashDouble(v) + 0x9e3779b97f4a7c15ul + (hash << 6) + (hash >> 2);
+	}
+
+	return hash ^ static_cast<size_t>(key.query.ignoreStartingReservations);
+}
@@ -4,16 +4,18 @@
 #include "agent/path_planning/Rectangle.h"
 #include "Math.h"
 
-Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime, double endTime, int ownerId) :
+Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime, double endTime, int ownerId, double sweepDuration) :
 		pos(pos_),
 		size(size_),
 		rotation(rotation_),
 		startTime(startTime),
 		endTime(endTime),
-		ownerId(ownerId)
+		ownerId(ownerId),
+		sweepDuration(sweepDuration)
 {
+	// Swept reservations keep their exact rotation, rounding would move the ends of long center lines sideways
 	isAxisAligned = false;
-	if(static_cast<int>(std::roundf(rotation)) % 90 == 0) {
+	if(sweepDuration == 0 && static_cast<int>(std::roundf(rotation)) % 90 == 0) {
 		rotation = std::roundf(rotation);
 		isAxisAligned = true;
 	}
@@ -47,8 +49,16 @@ Rectangle::Rectangle(Point pos_, Point size_, float rotation_, double startTime,
 	maxXInflated = std::max({pointsInflated[0].x, pointsInflated[1].x, pointsInflated[2].x, pointsInflated[3].x});
 	minYInflated = std::min({pointsInflated[0].y, pointsInflated[1].y, pointsInflated[2].y, pointsInflated[3].y});
 	maxYInflated = std::max({pointsInflated[0].y, pointsInflated[1].y, pointsInflated[2].y, pointsInflated[3].y});
+	
+	// Center line of the capsule, shortened by the radius on both ends so that the capsule fits into the rectangle
+	Point halfCenterLine = Math::rotateVector(Point(std::max(0.0, (size.x - size.y) * 0.5), 0), rotation);
+	sweepStart = pos - halfCenterLine;
+	sweepEnd = pos + halfCenterLine;
 }
 
+Rectangle::Rectangle(Point pos, Point size, float rotation, double startTime, double endTime, int ownerId) :
+		Rectangle(pos, size, rotation, startTime, endTime, ownerId, 0) {}
+
 Rectangle::Rectangle(Point pos, Point size, float rotation) :
 		Rectangle(pos, size, rotation, -1, -1, -1) {}
 
@@ -96,6 +106,26 @@ double Rectangle::getFreeAfter() const {
 	return endTime;
 }
 
+bool Rectangle::getIsSwept() const {
+	return sweepDuration > 0;
+}
+
+double Rectangle::getSweepDuration() const {
+	return sweepDuration;
+}
+
+Point Rectangle::getSweepStart() const {
+	return sweepStart;
+}
+
+Point Rectangle::getSweepEnd() const {
+	return sweepEnd;
+}
+
+double Rectangle::getSweepRadius() const {
+	return size.y * 0.5f;
+}
+
 double Rectangle::getStartTime() const {
 	return startTime;
 }
@@ -118,7 +148,8 @@ bool operator ==(const Rectangle& left, const Rectangle& right) {
 	       left.getPosition() == right.getPosition() &&
 	       left.getSize() == right.getSize() &&
 	       left.getRotation() == right.getRotation() &&
-	       left.getOwnerId() == right.getOwnerId();			
+	       left.getOwnerId() == right.getOwnerId() &&
+	       left.getSweepDuration() == right.getSweepDuration();
 }
 
 bool operator !=(const Rectangle& left, const Rectangle& right) {
@@ -0,0 +1,53 @@
+#include <limits>
+
+#include "agent/path_planning/RectangleBatch.h"
+#include "Math.h"
+
+RectangleBatch::RectangleBatch() :
+	size(0)
+{
+}
+
+RectangleBatch::RectangleBatch(const std::vector<Rectangle>& rectangles) :
+	size(static_cast<int>(rectangles.size())),
+	rectangles(rectangles)
+{
+	unsigned long paddedSize = (rectangles.size() + laneCount - 1) / laneCount * laneCount + laneCount;
+	
+	// Padding: empty bounding box, never hit
+	minX.assign(paddedSize, std::numeric_limits<double>::max());
+	minY.assign(paddedSize, std::numeric_limits<double>::max());
+	maxX.assign(paddedSize, std::numeric_limits<double>::lowest());
+	maxY.assign(paddedSize, std::numeric_limits<double>::lowest());
+	cornerX.assign(paddedSize, 0);
+	cornerY.assign(paddedSize, 0);
+	abX.assign(paddedSize, 0);
+	abY.assign(paddedSize, 0);
+	adX.assign(paddedSize, 0);
+	adY.assign(paddedSize, 0);
+	abLengthSquared.assign(paddedSize, 0);
+	adLengthSquared.assign(paddedSize, 0);
+	isAxisAligned.assign(paddedSize, 1);
+	
+	for(unsigned long i = 0; i < rectangles.size(); i++) {
+		const Rectangle& r = rectangles[i];
+		minX[i] = r.getMinXInflated();
+		minY[i] = r.getMinYInflated();
+		maxX[i] = r.getMaxXInflated();
+		maxY[i] = r.getMaxYInflated();
+		
+		// Same expressions as Math::isPointInRectangle to get identical results
+		const Point* points = r.getPointsInflated();
+		Point ab = points[0] - points[1];
+		Point ad = points[0] - points[3];
+		cornerX[i] = points[0].x;
+		cornerY[i] = points[0].y;
+		abX[i] = ab.x;
+		abY[i] = ab.y;
+		adX[i] = ad.x;
+		adY[i] = ad.y;
+		abLengthSquared[i] = Math::dotProduct(ab, ab);
+		adLengthSquared[i] = Math::dotProduct(ad, ad);
+		isAxisAligned[i] = static_cast<unsigned char>(r.getIsAxisAligned() ? 1 : 0);
+	}
+}
@@ -0,0 +1,181 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#include "agent/path_planning/ReservationCodec.h"
+
+void ReservationCodec::encodeReservations(const std::vector<Rectangle>& reservations, std::vector<uint8_t>& bytes) {
+	writeVarint(reservations.size(), bytes);
+	if(reservations.empty()) {
+		return;
+	}
+
+	// Epoch of the list
+	double minStartTime = std::numeric_limits<double>::max();
+	for(const Rectangle& r : reservations) {
+		minStartTime = std::min(minStartTime, r.getStartTime());
+	}
+	auto epoch = static_cast<int64_t>(std::floor(minStartTime * unitsPerSecond + unitTolerance));
+	writeSignedVarint(epoch, bytes);
+
+	for(const Rectangle& r : reservations) {
+		float rotation = r.getRotation();
+		uint8_t flags = freeRotation;
+		if(rotation == std::round(rotation) && static_cast<int>(rotation) % 90 == 0) {
+			flags = static_cast<uint8_t>((static_cast<int>(rotation) / 90 % 4 + 4) % 4);
+		}
+		if(r.getIsSwept()) {
+			flags |= sweptFlag;
+		}
+		bytes.push_back(flags);
+
+		// If the position is rounded, the size grows by one unit on each side to cover it
+		double x = r.getPosition().x * unitsPerMeter;
+		double y = r.getPosition().y * unitsPerMeter;
+		int margin = (std::abs(x - std::round(x)) > unitTolerance || std::abs(y - std::round(y)) > unitTolerance) ? 2 : 0;
+		writeSignedVarint(std::llround(x), bytes);
+		writeSignedVarint(std::llround(y), bytes);
+		writeVarint(static_cast<uint64_t>(std::ceil(r.getSize().x * unitsPerMeter - unitTolerance)) + margin, bytes);
+		writeVarint(static_cast<uint64_t>(std::ceil(r.getSize().y * unitsPerMeter - unitTolerance)) + margin, bytes);
+
+		if((flags & ~sweptFlag) == freeRotation) {
+			uint8_t rotationBytes[sizeof(float)];
+			std::memcpy(rotationBytes, &rotation, sizeof(float));
+			bytes.insert(bytes.end(), rotationBytes, rotationBytes + sizeof(float));
+		}
+
+		auto start = static_cast<int64_t>(std::floor(r.getStartTime() * unitsPerSecond + unitTolerance));
+		auto end = static_cast<int64_t>(std::ceil(r.getEndTime() * unitsPerSecond - unitTolerance));
+		writeVarint(static_cast<uint64_t>(start - epoch), bytes);
+		writeVarint(static_cast<uint64_t>(end - start), bytes);
+
+		// A shorter sweep duration moves the occupied window earlier into the reservation and lets it leave later
+		if(r.getIsSwept()) {
+			writeVarint(static_cast<uint64_t>(std::floor(r.getSweepDuration() * unitsPerSecond + unitTolerance)), bytes);
+		}
+
+		writeSignedVarint(r.getOwnerId(), bytes);
+	}
+}
+
+bool ReservationCodec::decodeReservations(const std::vector<uint8_t>& bytes, int& offset, std::vector<Rectangle>& reservations) {
+	uint64_t count;
+	if(!readVarint(bytes, offset, count)) {
+		return false;
+	}
+	if(count == 0) {
+		return true;
+	}
+
+	int64_t epoch;
+	if(!readSignedVarint(bytes, offset, epoch)) {
+		return false;
+	}
+
+	for(uint64_t i = 0; i < count; i++) {
+		if(offset >= bytes.size()) {
+			return false;
+		}
+		uint8_t flags = bytes[offset++];
+
+		int64_t x, y, owner;
+		uint64_t sizeX, sizeY, start, duration, sweepDuration = 0;
+		if(!readSignedVarint(bytes, offset, x) || !readSignedVarint(bytes, offset, y) || !readVarint(bytes, offset, sizeX) || !readVarint(bytes, offset, sizeY)) {
+			return false;
+		}
+
+		float rotation = (flags & ~sweptFlag) * 90.f;
+		if((flags & ~sweptFlag) == freeRotation) {
+			if(offset + sizeof(float) > bytes.size()) {
+				return false;
+			}
+			std::memcpy(&rotation, &bytes[offset], sizeof(float));
+			offset += sizeof(float);
+		}
+
+		if(!readVarint(bytes, offset, start) || !readVarint(bytes, offset, duration)) {
+			return false;
+		}
+		if((flags & sweptFlag) && !readVarint(bytes, offset, sweepDuration)) {
+			return false;
+		}
+		if(!readSignedVarint(bytes, offset, owner)) {
+			return false;
+		}
+
+		double startTime = (epoch + static_cast<int64_t>(start)) / unitsPerSecond;
+		double endTime = (epoch + static_cast<int64_t>(start + duration)) / unitsPerSecond;
+		reservations.emplace_back(Point(static_cast<float>(x / unitsPerMeter), static_cast<float>(y / unitsPerMeter)), Point(static_cast<float>(sizeX / unitsPerMeter), static_cast<float>(sizeY / unitsPerMeter)), rotation, startTime, endTime, static_cast<int>(owner), sweepDuration / unitsPerSecond);
+	}
+
+	return true;
+}
+
+void ReservationCodec::encodeIds(const std::vector<unsigned long>& ids, std::vector<uint8_t>& bytes) {
+	writeVarint(ids.size(), bytes);
+
+	unsigned long previous = 0;
+	for(unsigned long id : ids) {
+		writeSignedVarint(static_cast<int64_t>(id - previous), bytes);
+		previous = id;
+	}
+}
+
+bool ReservationCodec::decodeIds(const std::vector<uint8_t>& bytes, int& offset, std::vector<unsigned long>& ids) {
+	uint64_t count;
+	if(!readVarint(bytes, offset, count)) {
+		return false;
+	}
+
+	unsigned long previous = 0;
+	for(uint64_t i = 0; i < count; i++) {
+		int64_t difference;
+		if(!readSignedVarint(bytes, offset, difference)) {
+			return false;
+		}
+		previous += difference;
+		ids.push_back(previous);
+	}
+
+	return true;
+}
+
+void ReservationCodec::writeVarint(uint64_t value, std::vector<uint8_t>& bytes) {
+	while(value >= 0x80) {
+		bytes.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(static_cast<uint8_t>(value));
+}
+
+bool ReservationCodec::readVarint(const std::vector<uint8_t>& bytes, int& offset, uint64_t& value) {
+	value = 0;
+	for(int shift = 0; shift < 64; shift += 7) {
+		if(offset >= bytes.size()) {
+			return false;
+		}
+
+		uint8_t byte = bytes[offset++];
+		value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if(!(byte & 0x80)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ReservationCodec::writeSignedVarint(int64_t value, std::vector<uint8_t>& bytes) {
+	writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63), bytes);
+}
+
+bool ReservationCodec::readSignedVarint(const std::vector<uint8_t>& bytes, int& offset, int64_t& value) {
+	uint64_t zigzag;
+	if(!readVarint(bytes, offset, zigzag)) {
+		return false;
+	}
+
+	value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+	return true;
+}
@@ -0,0 +1,52 @@
+#include "agent/path_planning/ReservationIndex.h"
+
+ReservationIndex::ReservationIndex(float width, float height, float cellSize) :
+	cellSize(cellSize)
+{
+	sizeX = std::max(1, static_cast<int>(std::ceil(width / cellSize)));
+	sizeY = std::max(1, static_cast<int>(std::ceil(height / cellSize)));
+	cells.resize(static_cast<unsigned long>(sizeX * sizeY));
+}
+
+int ReservationIndex::getClampedCell(double v, int size) const {
+	auto cell = static_cast<int>(std::floor(v / cellSize));
+	return std::max(0, std::min(size - 1, cell));
+}
+
+void ReservationIndex::add(int slot, const Rectangle& reservation) {
+	Entry e;
+	e.slot = slot;
+	e.startTime = reservation.getStartTime();
+	e.endTime = reservation.getEndTime();
+	e.minCellX = getClampedCell(reservation.getMinXInflated(), sizeX);
+	e.minCellY = getClampedCell(reservation.getMinYInflated(), sizeY);
+	e.maxCellX = getClampedCell(reservation.getMaxXInflated(), sizeX);
+	e.maxCellY = getClampedCell(reservation.getMaxYInflated(), sizeY);
+
+	for(int y = e.minCellY; y <= e.maxCellY; y++) {
+		for(int x = e.minCellX; x <= e.maxCellX; x++) {
+			cells[x + y * sizeX].push_back(e);
+		}
+	}
+}
+
+void ReservationIndex::remove(int slot, const Rectangle& reservation) {
+	int minCellX = getClampedCell(reservation.getMinXInflated(), sizeX);
+	int minCellY = getClampedCell(reservation.getMinYInflated(), sizeY);
+	int maxCellX = getClampedCell(reservation.getMaxXInflated(), sizeX);
+	int maxCellY = getClampedCell(reservation.getMaxYInflated(), sizeY);
+
+	for(int y = minCellY; y <= maxCellY; y++) {
+		for(int x = minCellX; x <= maxCellX; x++) {
+			std::vector<Entry>& cell = cells[x + y * sizeX];
+			
+			for(auto iter = cell.begin(); iter != cell.end(); iter++) {
+				if(iter->slot == slot) {
+					*iter = cell.back();
+					cell.pop_back();
+					break;
+				}
+			}
+		}
+	}
+}
@@ -1,20 +1,29 @@
 
 #include <include/agent/path_planning/ReservationManager.h>
 #include <auto_smart_factory/ReservationRequest.h>
+#include <auto_smart_factory/GetReservationSnapshot.h>
+#include <ros/param.h>
 
 #include "agent/path_planning/ReservationManager.h"
+#include "agent/path_planning/ReservationCodec.h"
 
 ReservationManager::ReservationManager(ros::Publisher* publisher, Map* map, int agentId, auto_smart_factory::WarehouseConfiguration warehouseConfig) :
 	publisher(publisher),
 	map(map),
 	agentId(agentId),
 	pathRetrievedCount(0),
+	knownTableVersion(0),
+	isResynchronizationPending(false),
+	nextResynchronizationTime(0),
 	hasReservedPath(false),
 	bidingForReservation(false),
 	replanningNecessary(false),
 	replanningBeneficial(false),
 	requestedEmergencyStop(false)
 {
+	ros::param::param<bool>("/compact_reservations", useCompactReservations, false);
+	ros::param::param<bool>("/swept_reservations", useSweptReservations, false);
+	
 	// Add infinite reservation for starting point
 	double infiniteReservationStartTime = ros::Time::now().toSec() - 1000.f;
 
@@ -38,31 +47,90 @@ void ReservationManager::update(Point pos) {
 		replanningNecessary = true;
 	}
 	
-	map->deleteExpiredReservations(now);		
+	map->deleteExpiredReservations(now);
+	
+	if(isResynchronizationPending && now >= nextResynchronizationTime) {
+		resynchronizeReservations();
+		
+		if(!isResynchronizationPending) {
+			if(bidingForReservation) {
+				// The answer to the own request may have been missed, bid again
+				if(calculateNewPath()) {
+					requestPathReservation();
+				}
+			} else {
+				saveReservationsAsLastReserved();
+			}
+		}
+	}
 }
 
 void ReservationManager::reservationBroadcastCallback(const auto_smart_factory::ReservationBroadcast& msg) {
-	// This only works if the messages arrive in order
-	if(msg.isReservationBroadcastOrDenial) {
-		std::vector<Rectangle> oldReservations;
-		oldReservations = map->deleteReservationsFromAgent(msg.ownerId);	
-						
-		std::vector<Rectangle> reservations = getReservationsFromMessage(msg);
-		map->addReservations(reservations);		
+	std::vector<Rectangle> oldReservations;
+	std::vector<Rectangle> reservations;
+	unsigned long firstReservationId = msg.firstReservationId;
+	std::vector<unsigned long> removedReservationIdRanges = msg.removedReservationIdRanges;
+	bool isResynchronized = false;
+	
+	if(!msg.compactReservations.empty()) {
+		// The ids follow the reservations, the first one is firstReservationId
+		int offset = 0;
+		std::vector<unsigned long> ids;
+		if(!ReservationCodec::decodeReservations(msg.compactReservations, offset, reservations) || !ReservationCodec::decodeIds(msg.compactReservations, offset, ids) || ids.empty()) {
+			ROS_ERROR("[RM %d] Malformed compact reservation broadcast from robot %d", agentId, msg.ownerId);
+			return;
+		}
+		firstReservationId = ids.front();
+		removedReservationIdRanges.assign(ids.begin() + 1, ids.end());
+	} else {
+		reservations = getReservationsFromMessage(msg.reservations);
+	}
+	
+	// Every reservation broadcast increases the version by one, denials keep it. A higher version means that broadcasts were missed
+	unsigned long expectedVersion = knownTableVersion + (msg.isReservationBroadcastOrDenial ? 1 : 0);
+	if(msg.tableVersion > expectedVersion) {
+		// A pending resynchronization is retried in update
+		if(!isResynchronizationPending) {
+			ROS_WARN("[RM %d] Missed reservation broadcasts after version %lu, requesting snapshot of version %lu", agentId, knownTableVersion, (unsigned long) msg.tableVersion);
+			isResynchronized = resynchronizeReservations();
+		}
+	} else if(msg.isReservationBroadcastOrDenial && msg.tableVersion == expectedVersion && !isResynchronizationPending) {
+		std::vector<unsigned long> removedIds;
+		for(int i = 0; i + 1 < removedReservationIdRanges.size(); i += 2) {
+			for(unsigned long id = removedReservationIdRanges[i]; id <= removedReservationIdRanges[i + 1]; id++) {
+				removedIds.push_back(id);
+			}
+		}
 		
+		std::vector<unsigned long> addedIds;
+		for(int i = 0; i < reservations.size(); i++) {
+			addedIds.push_back(firstReservationId + i);
+		}
+		
+		oldReservations = map->deleteReservations(removedIds);
+		map->addReservations(reservations, addedIds);
+		knownTableVersion = msg.tableVersion;
+	}
+	// Older broadcasts are already contained in the last snapshot
+	
+	if(msg.isReservationBroadcastOrDenial) {
 		if(msg.ownerId == agentId) {
 			if(msg.isEmergencyStop) {
 				requestedEmergencyStop = false;
+			} else if(isResynchronizationPending) {
+				// The granted reservations are missing in the map. Keep bidding, the path is requested again once the map is synchronized
+				ROS_WARN("[RM %d] Reservations granted while the map is out of date, bidding again after the next snapshot", agentId);
 			} else {
 				hasReservedPath = true;
 				bidingForReservation = false;
 				pathRetrievedCount = 0;
 			}
 
-			replanningNecessary = false;
-			replanningBeneficial = false;
-			saveReservationsAsLastReserved(msg);
-			
+			if(!isResynchronizationPending) {
+				replanningNecessary = false;
+				replanningBeneficial = false;
+				saveReservationsAsLastReserved();
+			}
 		} else {
 			if(!replanningBeneficial && isReplanningBeneficialWithoutTheseReservations(oldReservations)) {
 				ROS_WARN("[RM %d] Replanning beneficial because the path from robot %d was removed", agentId, msg.ownerId);
@@ -83,13 +151,37 @@ void ReservationManager::reservationBroadcastCallback(const auto_smart_factory::
 				requestPathReservation();
 			}
 		}		
-	}	
+	}
+	
+	if(isResynchronized && msg.ownerId != agentId && bidingForReservation) {
+		// The answer to the own request may have been missed, bid again
+		if(calculateNewPath()) {
+			requestPathReservation();
+		}
+	}
+}
+
+bool ReservationManager::resynchronizeReservations() {
+	std::string srvName = "/reservation_master/get_reservation_snapshot";
+	auto_smart_factory::GetReservationSnapshot srv;
+	if(!ros::service::call(srvName, srv)) {
+		ROS_ERROR("[RM %d] Failed to call service %s! Retrying in %.0f s", agentId, srvName.c_str(), resynchronizationRetryInterval);
+		isResynchronizationPending = true;
+		nextResynchronizationTime = ros::Time::now().toSec() + resynchronizationRetryInterval;
+		return false;
+	}
+	
+	map->replaceAllReservations(getReservationsFromMessage(srv.response.reservations), srv.response.reservationIds);
+	knownTableVersion = srv.response.tableVersion;
+	isResynchronizationPending = false;
+	
+	return true;
 }
 
-std::vector<Rectangle> ReservationManager::getReservationsFromMessage(const auto_smart_factory::ReservationBroadcast& msg) {
+std::vector<Rectangle> ReservationManager::getReservationsFromMessage(const std::vector<auto_smart_factory::Rectangle>& rectangles) {
 	std::vector<Rectangle> reservations;
-	for(auto r : msg.reservations) {
-		reservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId);
+	for(auto r : rectangles) {
+		reservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId, r.sweepDuration);
 	}
 	
 	return reservations;
@@ -101,6 +193,7 @@ void ReservationManager::publishEmergencyStop(Point pos) {
 	auto_smart_factory::ReservationRequest msg;
 	msg.ownerId = agentId;
 	msg.isEmergencyStop = static_cast<unsigned char>(true);
+	msg.knownTableVersion = knownTableVersion;
 	double infiniteReservationStartTime = ros::Time::now().toSec() - 1000.f;
 	
 	auto_smart_factory::Rectangle rectangle;
@@ -112,16 +205,14 @@ void ReservationManager::publishEmergencyStop(Point pos) {
 	rectangle.startTime = infiniteReservationStartTime;
 	rectangle.endTime = Map::infiniteReservationTime;
 	rectangle.ownerId = agentId;
+	rectangle.sweepDuration = 0;
 
 	msg.reservations.push_back(rectangle);
 	publisher->publish(msg);
 }
 
-void ReservationManager::saveReservationsAsLastReserved(const auto_smart_factory::ReservationBroadcast& msg) {
-	lastReservedPathReservations.clear();
-	for(auto r : msg.reservations) {
-		lastReservedPathReservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId);
-	}
+void ReservationManager::saveReservationsAsLastReserved() {
+	lastReservedPathReservations = map->getReservationsFromAgent(agentId);
 }
 
 void ReservationManager::requestPathReservation() {
@@ -130,10 +221,18 @@ void ReservationManager::requestPathReservation() {
 		msg.ownerId = agentId;
 		msg.bid = pathToReserve.getDuration();
 		msg.isEmergencyStop = static_cast<unsigned char>(false);
+		msg.knownTableVersion = knownTableVersion;
 		
 		bool startsAtTray = lastReservedPathReservations.size() > 1;
+		pathToReserve.useSweptReservations = useSweptReservations;
+		std::vector<Rectangle> reservations = pathToReserve.generateReservations(agentId, startsAtTray);
+		
+		if(useCompactReservations) {
+			ReservationCodec::encodeReservations(reservations, msg.compactReservations);
+			reservations.clear();
+		}
 
-		for(const auto& r : pathToReserve.generateReservations(agentId, startsAtTray)) {
+		for(const auto& r : reservations) {
 			auto_smart_factory::Rectangle rectangle;
 			rectangle.posX = r.getPosition().x;
 			rectangle.posY = r.getPosition().y;
@@ -143,6 +242,7 @@ void ReservationManager::requestPathReservation() {
 			rectangle.startTime = r.getStartTime();
 			rectangle.endTime = r.getEndTime();
 			rectangle.ownerId = r.getOwnerId();
+			rectangle.sweepDuration = r.getSweepDuration();
 
 			msg.reservations.push_back(rectangle);
 		}
@@ -199,7 +299,11 @@ bool ReservationManager::isReplanningNecessary() const {
 
 bool ReservationManager::isInOwnReservation(Point pos, double time) {
 	for(const Rectangle& r : lastReservedPathReservations) {
-		if(r.getStartTime() - 0.5f <= time && time <= r.getEndTime() + 0.5f && Math::isPointInRectangle(pos, r)) {
+		if(r.getIsSwept()) {
+			if(Math::isPointInSweptRectangle(pos, r, time - 0.5f, time + 0.5f, true)) {
+				return true;
+			}
+		} else if(r.getStartTime() - 0.5f <= time && time <= r.getEndTime() + 0.5f && Math::isPointInRectangle(pos, r)) {
 			return true;
 		}
 	}
@@ -242,7 +346,7 @@ bool ReservationManager::isReplanningBeneficialWithoutTheseReservations(const st
 
 	double pathFinishTime = pathToReserve.getDepartureTimes().back();
 	for(const Rectangle& r : oldReservations) {
-		if(Math::isPointInRectangle(Point(pathToReserve.getEnd().x, pathToReserve.getEnd().y), r) && r.getEndTime() - r.getStartTime() >= 45.f && std::abs(pathFinishTime - r.getEndTime()) <= 6.f) {
+		if(!r.getIsSwept() && Math::isPointInRectangle(Point(pathToReserve.getEnd().x, pathToReserve.getEnd().y), r) && r.getEndTime() - r.getStartTime() >= 45.f && std::abs(pathFinishTime - r.getEndTime()) <= 6.f) {
 			return true;
 		}	
 	}
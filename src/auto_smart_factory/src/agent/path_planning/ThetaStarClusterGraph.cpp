@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <queue>
+
+#include "Math.h"
+#include "agent/path_planning/ThetaStarClusterGraph.h"
+#include "agent/path_planning/ThetaStarMap.h"
+
+ThetaStarClusterGraph::ThetaStarClusterGraph(const ThetaStarMap& map, std::vector<int> nodeClusters, int clusterCount) :
+	nodeClusters(std::move(nodeClusters)),
+	clusterNodes(static_cast<unsigned long>(clusterCount)),
+	clusterEntrances(static_cast<unsigned long>(clusterCount))
+{
+	nodeIndicesInCluster.resize(this->nodeClusters.size());
+	for(int id = 0; id < static_cast<int>(this->nodeClusters.size()); id++) {
+		std::vector<int>& nodesOfCluster = clusterNodes[this->nodeClusters[id]];
+		nodeIndicesInCluster[id] = static_cast<int>(nodesOfCluster.size());
+		nodesOfCluster.push_back(id);
+	}
+	nodeEntrances.assign(this->nodeClusters.size(), -1);
+
+	auto isLinked = [&](int id1, int id2) {
+		for(int neighbourId : map.getNeighbours(map.getNode(id1))) {
+			if(neighbourId == id2) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// Links crossing a border, grouped by the (smaller, larger) cluster pair. The first node of a link is in the smaller cluster
+	std::map<std::pair<int, int>, std::vector<std::pair<int, int>>> borderLinks;
+	for(int id = 0; id < static_cast<int>(this->nodeClusters.size()); id++) {
+		for(int neighbourId : map.getNeighbours(map.getNode(id))) {
+			if(this->nodeClusters[id] < this->nodeClusters[neighbourId]) {
+				borderLinks[std::make_pair(this->nodeClusters[id], this->nodeClusters[neighbourId])].emplace_back(id, neighbourId);
+			}
+		}
+	}
+
+	std::vector<std::vector<Edge>> adjacency;
+	auto addEdge = [&](int from, int to, float cost) {
+		adjacency.resize(entranceNodeIds.size());
+		adjacency[from].push_back(Edge{to, cost});
+	};
+
+	for(const auto& border : borderLinks) {
+		const std::vector<std::pair<int, int>>& links = border.second;
+
+		// Split the border into contiguous sections. Links belong to the same section if their nodes on one side are the same or linked
+		std::vector<int> section(links.size());
+		std::iota(section.begin(), section.end(), 0);
+		std::function<int(int)> findSection = [&](int i) {
+			return section[i] == i ? i : section[i] = findSection(section[i]);
+		};
+		for(unsigned long i = 0; i < links.size(); i++) {
+			for(unsigned long j = i + 1; j < links.size(); j++) {
+				bool sameSide1 = links[i].first == links[j].first || isLinked(links[i].first, links[j].first);
+				bool sameSide2 = links[i].second == links[j].second || isLinked(links[i].second, links[j].second);
+				if(sameSide1 || sameSide2) {
+					section[findSection(static_cast<int>(i))] = findSection(static_cast<int>(j));
+				}
+			}
+		}
+
+		// The link closest to the center of a section becomes its entrance
+		std::map<int, Point> sectionCenters;
+		std::map<int, int> sectionSizes;
+		for(unsigned long i = 0; i < links.size(); i++) {
+			int s = findSection(static_cast<int>(i));
+			Point center = (map.getNode(links[i].first)->getPosition() + map.getNode(links[i].second)->getPosition()) / 2.0;
+			sectionCenters[s] = sectionSizes[s] == 0 ? center : sectionCenters[s] + center;
+			sectionSizes[s]++;
+		}
+
+		std::map<int, int> sectionLinks;
+		for(unsigned long i = 0; i < links.size(); i++) {
+			int s = findSection(static_cast<int>(i));
+			Point sectionCenter = sectionCenters[s] / static_cast<double>(sectionSizes[s]);
+			auto getCenterDistance = [&](int link) {
+				return Math::getDistance((map.getNode(links[link].first)->getPosition() + map.getNode(links[link].second)->getPosition()) / 2.0, sectionCenter);
+			};
+
+			auto iter = sectionLinks.find(s);
+			if(iter == sectionLinks.end() || getCenterDistance(static_cast<int>(i)) < getCenterDistance(iter->second)) {
+				sectionLinks[s] = static_cast<int>(i);
+			}
+		}
+
+		for(const auto& sectionLink : sectionLinks) {
+			const std::pair<int, int>& link = links[sectionLink.second];
+			int entrance1 = addEntrance(link.first);
+			int entrance2 = addEntrance(link.second);
+			auto cost = static_cast<float>(Math::getDistance(map.getNode(link.first)->getPosition(), map.getNode(link.second)->getPosition()));
+			addEdge(entrance1, entrance2, cost);
+			addEdge(entrance2, entrance1, cost);
+		}
+	}
+
+	// Connect the entrances of every cluster by their distance inside the cluster
+	std::vector<float> distances;
+	for(const std::vector<int>& entrances : clusterEntrances) {
+		for(int entrance : entrances) {
+			getDistancesInCluster(map, map.getNode(entranceNodeIds[entrance]), distances);
+
+			for(int other : entrances) {
+				float distance = distances[nodeIndicesInCluster[entranceNodeIds[other]]];
+				if(other != entrance && distance != std::numeric_limits<float>::max()) {
+					addEdge(entrance, other, distance);
+				}
+			}
+		}
+	}
+
+	adjacency.resize(entranceNodeIds.size());
+	edgeOffsets.reserve(entranceNodeIds.size() + 1);
+	for(const std::vector<Edge>& entranceEdges : adjacency) {
+		edgeOffsets.push_back(static_cast<int>(edges.size()));
+		edges.insert(edges.end(), entranceEdges.begin(), entranceEdges.end());
+	}
+	edgeOffsets.push_back(static_cast<int>(edges.size()));
+}
+
+bool ThetaStarClusterGraph::findCorridor(const ThetaStarMap& map, const GridNode* start, const GridNode* target, std::vector<int>& corridor) const {
+	int startCluster = getCluster(start);
+	int targetCluster = getCluster(target);
+	if(startCluster == targetCluster) {
+		return false;
+	}
+
+	std::vector<float> startDistances;
+	std::vector<float> targetDistances;
+	getDistancesInCluster(map, start, startDistances);
+	getDistancesInCluster(map, target, targetDistances);
+
+	auto getHeuristic = [&](int entrance) {
+		return static_cast<float>(Math::getDistance(map.getNode(entranceNodeIds[entrance])->getPosition(), target->getPosition()));
+	};
+
+	// A* over the entrances, starting at all reachable entrances of the start cluster
+	std::vector<float> costs(entranceNodeIds.size(), std::numeric_limits<float>::max());
+	std::vector<int> prev(entranceNodeIds.size(), -1);
+	typedef std::pair<float, int> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+	for(int entrance : clusterEntrances[startCluster]) {
+		float distance = startDistances[nodeIndicesInCluster[entranceNodeIds[entrance]]];
+		if(distance != std::numeric_limits<float>::max()) {
+			costs[entrance] = distance;
+			queue.emplace(distance + getHeuristic(entrance), entrance);
+		}
+	}
+
+	float bestCost = std::numeric_limits<float>::max();
+	int bestEntrance = -1;
+	while(!queue.empty()) {
+		QueueEntry current = queue.top();
+		queue.pop();
+
+		// Distances to the target are at least as long as the heuristic, so no later entrance can lead to a shorter path
+		if(current.first >= bestCost) {
+			break;
+		}
+		if(current.first > costs[current.second] + getHeuristic(current.second)) {
+			continue;
+		}
+
+		int entrance = current.second;
+		if(getCluster(map.getNode(entranceNodeIds[entrance])) == targetCluster) {
+			float distance = targetDistances[nodeIndicesInCluster[entranceNodeIds[entrance]]];
+			if(distance != std::numeric_limits<float>::max() && costs[entrance] + distance < bestCost) {
+				bestCost = costs[entrance] + distance;
+				bestEntrance = entrance;
+			}
+		}
+
+		for(int i = edgeOffsets[entrance]; i < edgeOffsets[entrance + 1]; i++) {
+			const Edge& edge = edges[i];
+			float cost = costs[entrance] + edge.cost;
+			if(cost < costs[edge.to]) {
+				costs[edge.to] = cost;
+				prev[edge.to] = entrance;
+				queue.emplace(cost + getHeuristic(edge.to), edge.to);
+			}
+		}
+	}
+
+	if(bestEntrance == -1) {
+		return false;
+	}
+
+	corridor.clear();
+	corridor.push_back(startCluster);
+	for(int entrance = bestEntrance; entrance != -1; entrance = prev[entrance]) {
+		corridor.push_back(nodeClusters[entranceNodeIds[entrance]]);
+	}
+	std::sort(corridor.begin(), corridor.end());
+	corridor.erase(std::unique(corridor.begin(), corridor.end()), corridor.end());
+
+	return true;
+}
+
+int ThetaStarClusterGraph::getCluster(const GridNode* node) const {
+	return nodeClusters[node->id];
+}
+
+int ThetaStarClusterGraph::getClusterCount() const {
+	return static_cast<int>(clusterNodes.size());
+}
+
+int ThetaStarClusterGraph::getEntranceCount() const {
+	return static_cast<int>(entranceNodeIds.size());
+}
+
+void ThetaStarClusterGraph::getDistancesInCluster(const ThetaStarMap& map, const GridNode* from, std::vector<float>& distances) const {
+	int cluster = nodeClusters[from->id];
+	const std::vector<int>& nodesOfCluster = clusterNodes[cluster];
+	distances.assign(nodesOfCluster.size(), std::numeric_limits<float>::max());
+
+	typedef std::pair<float, int> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	distances[nodeIndicesInCluster[from->id]] = 0;
+	queue.emplace(0.f, from->id);
+
+	while(!queue.empty()) {
+		QueueEntry current = queue.top();
+		queue.pop();
+		if(current.first > distances[nodeIndicesInCluster[current.second]]) {
+			continue;
+		}
+
+		const GridNode* node = map.getNode(current.second);
+		for(int neighbourId : map.getNeighbours(node)) {
+			if(nodeClusters[neighbourId] != cluster) {
+				continue;
+			}
+
+			auto distance = static_cast<float>(current.first + Math::getDistance(node->getPosition(), map.getNode(neighbourId)->getPosition()));
+			float& neighbourDistance = distances[nodeIndicesInCluster[neighbourId]];
+			if(distance < neighbourDistance) {
+				neighbourDistance = distance;
+				queue.emplace(distance, neighbourId);
+			}
+		}
+	}
+}
+
+int ThetaStarClusterGraph::addEntrance(int nodeId) {
+	if(nodeEntrances[nodeId] == -1) {
+		nodeEntrances[nodeId] = static_cast<int>(entranceNodeIds.size());
+		entranceNodeIds.push_back(nodeId);
+		clusterEntrances[nodeClusters[nodeId]].push_back(nodeEntrances[nodeId]);
+	}
+	return nodeEntrances[nodeId];
+}
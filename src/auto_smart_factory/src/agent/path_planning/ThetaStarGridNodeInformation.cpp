@@ -4,5 +4,7 @@ ThetaStarGridNodeInformation::ThetaStarGridNodeInformation(const GridNode* node,
 		node(node),
 		time(time),
 		prev(prev),
-		waitTimeAtPrev(0) 
+		waitTimeAtPrev(0),
+		safeInterval(0),
+		heapIndex(-1)
 {}
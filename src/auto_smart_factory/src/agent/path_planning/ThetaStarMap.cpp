@@ -1,4 +1,8 @@
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
 #include <include/agent/path_planning/ThetaStarMap.h>
 
 #include "agent/path_planning/ThetaStarMap.h"
@@ -6,56 +10,185 @@
 #include "ros/ros.h"
 #include "agent/path_planning/Map.h"
 
+const int ThetaStarMap::gridLinkDirections[8][2] = {{-1, 0}, {-1, -1}, {-1, 1}, {0, -1}, {0, 1}, {1, 0}, {1, -1}, {1, 1}};
+constexpr float ThetaStarMap::obstacleShrinkTolerance;
+
 ThetaStarMap::ThetaStarMap(Map* map, float resolution) :
 	map(map),
-	resolution(resolution)
+	gridSizeX(0),
+	gridSizeY(0),
+	resolution(resolution),
+	caches(new QueryCaches())
 {
+	caches->visibility = std::vector<std::atomic<uint64_t>>(1ul << visibilityCacheSizeLog2);
+	for(auto& entry : caches->visibility) {
+		entry.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+	}
+	caches->visibilityHits.store(0);
+	caches->visibilityMisses.store(0);
+	
 	Point start(map->getMargin(), map->getMargin());
 	Point end(map->getWidth() - map->getMargin(), map->getHeight() - map->getMargin());
+	gridOrigin = start;
+
+	// Count grid cells, using the same accumulation as the generation to get identical node positions
+	for(double x = start.x; x <= end.x; x += resolution) {
+		gridSizeX++;
+	}
+	for(double y = start.y; y <= end.y; y += resolution) {
+		gridSizeY++;
+	}
+	gridIndex.assign(static_cast<unsigned long>(gridSizeX * gridSizeY), -1);
 
 	// Generate
 	Point current = start;
-	while(current.x <= end.x) {
+	for(int ix = 0; ix < gridSizeX; ix++) {
 		current.y = start.y;
-		while(current.y <= end.y) {
+		for(int iy = 0; iy < gridSizeY; iy++) {
 			if(!map->isInsideAnyStaticInflatedObstacle(current)) {
-				nodes.emplace(std::pair<Point, GridNode*>(current, new GridNode(current)));
+				auto id = static_cast<int>(nodes.size());
+				gridIndex[ix + iy * gridSizeX] = id;
+				nodes.emplace_back(current, id);
 			}
 			current.y += resolution;
 		}
 		current.x += resolution;
 	}
+	nodes.shrink_to_fit();
 
-	// Link
-	for(const auto& element : nodes) {
-		linkToNode(element.second, element.second->pos + Point(- resolution, 0));
-		linkToNode(element.second, element.second->pos + Point(- resolution, - resolution));
-		linkToNode(element.second, element.second->pos + Point(- resolution, + resolution));
-		linkToNode(element.second, element.second->pos + Point(0, - resolution));
-		linkToNode(element.second, element.second->pos + Point(0, + resolution));
-		linkToNode(element.second, element.second->pos + Point(+ resolution, 0));
-		linkToNode(element.second, element.second->pos + Point(+ resolution, - resolution));
-		linkToNode(element.second, element.second->pos + Point(+ resolution, + resolution));
+	// Link. Grid nodes only link to grid nodes, so there are no explicit links yet
+	for(int direction = 0; direction < 8; direction++) {
+		gridLinkCellOffsets[direction] = gridLinkDirections[direction][0] + gridLinkDirections[direction][1] * gridSizeX;
+	}
+	gridLinks.assign(nodes.size(), 0);
+	neighbourOffsets.assign(nodes.size() + 1, 0);
+	for(int ix = 0; ix < gridSizeX; ix++) {
+		for(int iy = 0; iy < gridSizeY; iy++) {
+			int id = getGridNodeId(ix, iy);
+			if(id == -1) {
+				continue;
+			}
+			
+			const GridNode& node = nodes[id];
+			for(int direction = 0; direction < 8; direction++) {
+				if(linkToGridCell(node, ix + gridLinkDirections[direction][0], iy + gridLinkDirections[direction][1])) {
+					gridLinks[id] |= static_cast<uint8_t>(1u << direction);
+				}
+			}
+		}
 	}
 }
 
-void ThetaStarMap::linkToNode(GridNode* node, Point targetPos) {
-	auto iter = nodes.find(targetPos);
-	if(iter != nodes.end() && map->isStaticLineOfSightFree(node->pos, targetPos)) {
-		node->neighbours.push_back(iter->second);
+bool ThetaStarMap::linkToGridCell(const GridNode& node, int ix, int iy) {
+	int targetId = getGridNodeId(ix, iy);
+	return targetId != -1 && map->isStaticLineOfSightFree(node.getPosition(), nodes[targetId].getPosition());
+}
+
+int ThetaStarMap::getGridCell(const GridNode& node) const {
+	auto ix = static_cast<int>(std::lround((node.x - gridOrigin.x) / resolution));
+	auto iy = static_cast<int>(std::lround((node.y - gridOrigin.y) / resolution));
+	return ix + iy * gridSizeX;
+}
+
+int ThetaStarMap::getGridNodeId(int ix, int iy) const {
+	if(ix < 0 || iy < 0 || ix >= gridSizeX || iy >= gridSizeY) {
+		return -1;
 	}
+	
+	return gridIndex[ix + iy * gridSizeX];
+}
+
+int ThetaStarMap::getNodeIdAt(const Point& pos) const {
+	auto ix = static_cast<int>(std::lround((pos.x - gridOrigin.x) / resolution));
+	auto iy = static_cast<int>(std::lround((pos.y - gridOrigin.y) / resolution));
+	int id = getGridNodeId(ix, iy);
+	
+	// Node positions are stored with float precision
+	if(id != -1 && nodes[id].x == static_cast<float>(pos.x) && nodes[id].y == static_cast<float>(pos.y)) {
+		return id;
+	}
+	
+	auto iter = additionalNodes.find(pos);
+	if(iter != additionalNodes.end()) {
+		return iter->second;
+	}
+	
+	return -1;
+}
+
+const GridNode* ThetaStarMap::getNode(int id) const {
+	return &nodes[id];
+}
+
+ThetaStarMap::NeighbourRange ThetaStarMap::getNeighbours(const GridNode* node) const {
+	unsigned int links = gridLinks[node->id];
+	const int* cell = links != 0 ? gridIndex.data() + getGridCell(*node) : nullptr;
+	const uint32_t* explicitLinks = neighbourIds.data();
+	
+	return NeighbourRange{
+		NeighbourIterator(cell, gridLinkCellOffsets, links, explicitLinks + neighbourOffsets[node->id]),
+		NeighbourIterator(cell, gridLinkCellOffsets, 0, explicitLinks + neighbourOffsets[node->id + 1])
+	};
+}
+
+int ThetaStarMap::getNodeCount() const {
+	return static_cast<int>(nodes.size());
+}
+
+int ThetaStarMap::getCellKey(int ix, int iy) const {
+	return (iy + 1) * (gridSizeX + 2) + (ix + 1);
 }
 
 const GridNode* ThetaStarMap::getNodeClosestTo(const Point& pos) const {
 	double shortestDistance = std::numeric_limits<float>::max();
 	const GridNode* nearestNode = nullptr;
-	
-	for(const auto& element : nodes) {
-		double distance = Math::getDistanceSquared(element.first, pos);
 
-		if(distance < shortestDistance) {
+	auto considerNode = [&](int id) {
+		double distance = Math::getDistanceSquared(nodes[id].getPosition(), pos);
+		
+		// Prefer the lower id on ties, same as a linear scan over all nodes
+		if(distance < shortestDistance || (nearestNode != nullptr && distance == shortestDistance && id < nearestNode->id)) {
 			shortestDistance = distance;
-			nearestNode = element.second;
+			nearestNode = &nodes[id];
+		}
+	};
+	
+	auto considerCell = [&](int ix, int iy) {
+		int id = getGridNodeId(ix, iy);
+		if(id != -1) {
+			considerNode(id);
+		}
+
+		if(ix >= -1 && iy >= -1 && ix <= gridSizeX && iy <= gridSizeY) {
+			auto iter = additionalNodesByCell.find(getCellKey(ix, iy));
+			if(iter != additionalNodesByCell.end()) {
+				for(int additionalId : iter->second) {
+					considerNode(additionalId);
+				}
+			}
+		}
+	};
+
+	auto cx = static_cast<int>(std::lround((pos.x - gridOrigin.x) / resolution));
+	auto cy = static_cast<int>(std::lround((pos.y - gridOrigin.y) / resolution));
+	int maxRing = std::max({std::abs(cx + 1), std::abs(cx - gridSizeX), std::abs(cy + 1), std::abs(cy - gridSizeY)});
+
+	for(int ring = 0; ring <= maxRing; ring++) {
+		// Visit only the border cells of this ring
+		for(int ix = cx - ring; ix <= cx + ring; ix++) {
+			if(ix == cx - ring || ix == cx + ring) {
+				for(int iy = cy - ring; iy <= cy + ring; iy++) {
+					considerCell(ix, iy);
+				}
+			} else {
+				considerCell(ix, cy - ring);
+				considerCell(ix, cy + ring);
+			}
+		}
+
+		// Both pos and every node are at most half a cell away from their cell center, so nodes in further rings are at least ring * resolution away
+		if(nearestNode != nullptr && shortestDistance < (ring * resolution) * (ring * resolution)) {
+			break;
 		}
 	}
 
@@ -66,48 +199,401 @@ const GridNode* ThetaStarMap::getNodeClosestTo(const Point& pos) const {
 	return nearestNode;
 }
 
-TimedLineOfSightResult ThetaStarMap::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<Rectangle>& smallerReservations) const {
-	return map->whenIsTimedLineOfSightFree(pos1, startTime, pos2, endTime, smallerReservations);
+TimedLineOfSightResult ThetaStarMap::whenIsTimedLineOfSightFree(const Point& pos1, double startTime, const Point& pos2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const {
+	return map->whenIsTimedLineOfSightFree(pos1, startTime, pos2, endTime, smallerReservationIds);
 }
 
-bool ThetaStarMap::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<Rectangle>& smallerReservations) const {
-	return map->isTimedConnectionFree(pos1, pos2, startTime, waitingTime, drivingTime, smallerReservations);
+bool ThetaStarMap::isTimedConnectionFree(const Point& pos1, const Point& pos2, double startTime, double waitingTime, double drivingTime, const std::vector<unsigned long>& smallerReservationIds) const {
+	return map->isTimedConnectionFree(pos1, pos2, startTime, waitingTime, drivingTime, smallerReservationIds);
 }
 
-bool ThetaStarMap::addAdditionalNode(Point pos) {
-	if(!map->isPointInMap(pos) || map->isInsideAnyStaticInflatedObstacle(pos)) {
-		return false;
+TimedLineOfSightResult ThetaStarMap::whenIsTimedLineOfSightFree(const GridNode* node1, double startTime, const GridNode* node2, double endTime, const std::vector<unsigned long>& smallerReservationIds) const {
+	if(!isStaticLineOfSightFree(node1, node2)) {
+		TimedLineOfSightResult result;
+		result.blockedByStatic = true;
+		return result;
 	}
+	
+	return map->whenIsReservationLineOfSightFree(node1->getPosition(), startTime, node2->getPosition(), endTime, smallerReservationIds);
+}
 
-	// Add new node
-	GridNode* newGridNode = new GridNode(pos);
-	auto emplaceResult = nodes.emplace(std::pair<Point, GridNode*>(pos, newGridNode));
+bool ThetaStarMap::isStaticLineOfSightFree(const GridNode* node1, const GridNode* node2) const {
+	// Nodes are only linked if their line of sight is free
+	for(int neighbourId : getNeighbours(node1)) {
+		if(neighbourId == node2->id) {
+			return true;
+		}
+	}
+	
+	auto smallerId = static_cast<uint64_t>(std::min(node1->id, node2->id));
+	auto largerId = static_cast<uint64_t>(std::max(node1->id, node2->id));
+	uint64_t key = (smallerId << 32) | largerId;
+	uint64_t visibleFlag = 1ull << 63;
+	
+	// Fibonacci hashing to spread neighbouring node pairs over the whole table.
+	// Every entry contains its own key, so relaxed loads and stores are enough for concurrent queries
+	std::atomic<uint64_t>& entry = caches->visibility[(key * 11400714819323198485ull) >> (64 - visibilityCacheSizeLog2)];
+	uint64_t value = entry.load(std::memory_order_relaxed);
+	if((value & ~visibleFlag) == key) {
+		caches->visibilityHits.fetch_add(1, std::memory_order_relaxed);
+		return (value & visibleFlag) != 0;
+	}
+	
+	caches->visibilityMisses.fetch_add(1, std::memory_order_relaxed);
+	bool isFree = map->isStaticLineOfSightFree(node1->getPosition(), node2->getPosition());
+	entry.store(isFree ? (key | visibleFlag) : key, std::memory_order_relaxed);
+	
+	return isFree;
+}
 
-	// If node was newly added
-	if(emplaceResult.second) {
-		double maxDistance = resolution * resolution;
+void ThetaStarMap::getVisibilityCacheStatistics(unsigned long& hits, unsigned long& misses) const {
+	hits = caches->visibilityHits.load();
+	misses = caches->visibilityMisses.load();
+}
 
-		for(std::pair<Point, GridNode*> neighbour : nodes) {
-			double distance = Math::getDistanceSquared(neighbour.first, pos);
+unsigned long ThetaStarMap::getVisibilityCacheMemoryUsage() const {
+	return caches->visibility.capacity() * sizeof(uint64_t);
+}
 
-			if(distance <= maxDistance && map->isStaticLineOfSightFree(pos, neighbour.first))  {
-				newGridNode->neighbours.push_back(neighbour.second);
-				neighbour.second->neighbours.push_back(newGridNode);
+void ThetaStarMap::addLandmarks(const std::vector<Point>& positions) {
+	// Building a table costs nodes times corners. Large maps are searched hierarchically, there the tables save too few expansions to be worth it
+	if(static_cast<int>(nodes.size()) >= minNodeCountForClusterGraph) {
+		return;
+	}
+	
+	for(const Point& pos : positions) {
+		const GridNode* node = getNodeClosestTo(pos);
+		if(node != nullptr) {
+			landmarkNodeIds.insert(node->id);
+		}
+	}
+	
+	// Shrinking the non-inflated size shrinks the inflated rectangle by the same amount
+	std::vector<Rectangle> shrunkObstacles;
+	for(const Rectangle& obstacle : map->getObstacles()) {
+		Point size = obstacle.getSize() - Point(obstacleShrinkTolerance * 2, obstacleShrinkTolerance * 2);
+		shrunkObstacles.emplace_back(obstacle.getPosition(), Point(std::max(size.x, 0.0), std::max(size.y, 0.0)), obstacle.getRotation());
+	}
+	shrunkObstacleHierarchy = BoundingVolumeHierarchy(shrunkObstacles);
+	
+	// Paths between nodes stay inside the bounding box of the nodes. Corners inside other obstacles can not be passed
+	Point minNode(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+	Point maxNode(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+	for(const GridNode& node : nodes) {
+		Point position = node.getPosition();
+		minNode = Point(std::min(minNode.x, position.x), std::min(minNode.y, position.y));
+		maxNode = Point(std::max(maxNode.x, position.x), std::max(maxNode.y, position.y));
+	}
+	
+	obstacleCorners.clear();
+	for(const Rectangle& obstacle : map->getObstacles()) {
+		for(int i = 0; i < 4; i++) {
+			const Point& corner = obstacle.getPointsInflated()[i];
+			bool isNearNodes = corner.x >= minNode.x - obstacleShrinkTolerance && corner.x <= maxNode.x + obstacleShrinkTolerance && corner.y >= minNode.y - obstacleShrinkTolerance && corner.y <= maxNode.y + obstacleShrinkTolerance;
+			if(isNearNodes && !shrunkObstacleHierarchy.isPointInAnyRectangle(corner)) {
+				obstacleCorners.push_back(corner);
+			}
+		}
+	}
+	
+	visibleObstacleCorners.assign(obstacleCorners.size(), std::vector<int>());
+	for(int i = 0; i < static_cast<int>(obstacleCorners.size()); i++) {
+		for(int j = i + 1; j < static_cast<int>(obstacleCorners.size()); j++) {
+			if(!shrunkObstacleHierarchy.doesLineSegmentIntersectAnyRectangle(obstacleCorners[i], obstacleCorners[j])) {
+				visibleObstacleCorners[i].push_back(j);
+				visibleObstacleCorners[j].push_back(i);
 			}
 		}
-	} else {
-		delete newGridNode;
 	}
+}
+
+const std::vector<float>* ThetaStarMap::getLandmarkDistances(const GridNode* landmark) const {
+	if(landmarkNodeIds.find(landmark->id) == landmarkNodeIds.end()) {
+		return nullptr;
+	}
+	
+	// Elements of an unordered_map keep their address, so the returned table stays valid after the lock is released
+	std::lock_guard<std::mutex> lock(caches->landmarkDistanceTablesMutex);
+	auto iter = caches->landmarkDistanceTables.find(landmark->id);
+	if(iter != caches->landmarkDistanceTables.end()) {
+		return &iter->second;
+	}
+	
+	std::vector<float>& distances = caches->landmarkDistanceTables[landmark->id];
+	distances.assign(nodes.size(), std::numeric_limits<float>::max());
+	Point landmarkPosition = landmark->getPosition();
+	
+	// Theta* only moves along node links, nodes which are not linked to the landmark keep the maximum distance. The ids are collected in breadth first order
+	std::vector<int> parentNodeIds(nodes.size(), -1);
+	std::vector<int> linkedNodeIds = {landmark->id};
+	parentNodeIds[landmark->id] = landmark->id;
+	for(unsigned long i = 0; i < linkedNodeIds.size(); i++) {
+		for(int neighbourId : getNeighbours(&nodes[linkedNodeIds[i]])) {
+			if(parentNodeIds[neighbourId] == -1) {
+				parentNodeIds[neighbourId] = linkedNodeIds[i];
+				linkedNodeIds.push_back(neighbourId);
+			}
+		}
+	}
+	
+	// Dijkstra over the visibility graph of the obstacle corners gives the shortest path from the landmark to every corner
+	typedef std::pair<double, int> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	std::vector<double> cornerDistances(obstacleCorners.size(), std::numeric_limits<double>::max());
+	for(int i = 0; i < static_cast<int>(obstacleCorners.size()); i++) {
+		if(!shrunkObstacleHierarchy.doesLineSegmentIntersectAnyRectangle(landmarkPosition, obstacleCorners[i])) {
+			cornerDistances[i] = Math::getDistance(landmarkPosition, obstacleCorners[i]);
+			queue.emplace(cornerDistances[i], i);
+		}
+	}
+	
+	std::vector<std::pair<double, int>> reachedCorners;
+	while(!queue.empty()) {
+		QueueEntry current = queue.top();
+		queue.pop();
+		if(current.first > cornerDistances[current.second]) {
+			continue;
+		}
+		reachedCorners.push_back(current);
+		
+		for(int neighbour : visibleObstacleCorners[current.second]) {
+			double distance = current.first + Math::getDistance(obstacleCorners[current.second], obstacleCorners[neighbour]);
+			if(distance < cornerDistances[neighbour]) {
+				cornerDistances[neighbour] = distance;
+				queue.emplace(distance, neighbour);
+			}
+		}
+	}
+	
+	// A node either sees the landmark or its shortest path bends last at a corner it sees. Corners are ordered by their distance, so the search stops once no corner can improve the distance.
+	// The last corner of the node it was reached from is tried first, usually it is the last corner of this node as well and only few other corners have to be checked
+	std::vector<int> lastCorners(nodes.size(), -1);
+	for(int id : linkedNodeIds) {
+		Point position = nodes[id].getPosition();
+		double distance = std::numeric_limits<double>::max();
+		
+		if(!shrunkObstacleHierarchy.doesLineSegmentIntersectAnyRectangle(landmarkPosition, position)) {
+			distance = Math::getDistance(landmarkPosition, position);
+		} else {
+			int parentCorner = lastCorners[parentNodeIds[id]];
+			if(parentCorner != -1 && !shrunkObstacleHierarchy.doesLineSegmentIntersectAnyRectangle(obstacleCorners[parentCorner], position)) {
+				distance = cornerDistances[parentCorner] + Math::getDistance(obstacleCorners[parentCorner], position);
+				lastCorners[id] = parentCorner;
+			}
+			
+			// Without visibility checks left, the remaining corners are assumed to be visible. This keeps the bound, it only gets less tight
+			int remainingVisibilityChecks = maxLandmarkVisibilityChecks;
+			for(const auto& corner : reachedCorners) {
+				if(corner.first >= distance) {
+					break;
+				}
+				
+				double cornerDistance = corner.first + Math::getDistance(obstacleCorners[corner.second], position);
+				if(cornerDistance >= distance) {
+					continue;
+				}
+				
+				if(remainingVisibilityChecks == 0) {
+					distance = cornerDistance;
+					lastCorners[id] = -1;
+				} else {
+					remainingVisibilityChecks--;
+					if(!shrunkObstacleHierarchy.doesLineSegmentIntersectAnyRectangle(obstacleCorners[corner.second], position)) {
+						distance = cornerDistance;
+						lastCorners[id] = corner.second;
+					}
+				}
+			}
+		}
+		
+		// Rounded down so that the bound also holds in float precision
+		auto bound = static_cast<float>(distance);
+		distances[id] = bound > distance ? std::nextafter(bound, 0.f) : bound;
+	}
+	
+	return &distances;
+}
+
+std::unique_ptr<ThetaStarSearchArena> ThetaStarMap::acquireSearchArena() const {
+	std::unique_ptr<ThetaStarSearchArena> arena;
+	{
+		std::lock_guard<std::mutex> lock(caches->searchArenasMutex);
+		if(!caches->searchArenas.empty()) {
+			arena = std::move(caches->searchArenas.back());
+			caches->searchArenas.pop_back();
+		}
+	}
+	
+	if(arena == nullptr) {
+		arena.reset(new ThetaStarSearchArena());
+	}
+	arena->reset(getNodeCount());
+	
+	return arena;
+}
+
+void ThetaStarMap::releaseSearchArena(std::unique_ptr<ThetaStarSearchArena> arena) const {
+	std::lock_guard<std::mutex> lock(caches->searchArenasMutex);
+	caches->searchArenas.push_back(std::move(arena));
+}
+
+bool ThetaStarMap::buildClusterGraph() {
+	if(static_cast<int>(nodes.size()) < minNodeCountForClusterGraph) {
+		clusterGraph = ThetaStarClusterGraph();
+		return false;
+	}
+	
+	int clustersX = (gridSizeX + clusterSize - 1) / clusterSize;
+	int clustersY = (gridSizeY + clusterSize - 1) / clusterSize;
+	
+	// Additional nodes belong to the cluster of their closest grid cell
+	std::vector<int> nodeClusters(nodes.size());
+	for(const GridNode& node : nodes) {
+		auto ix = static_cast<int>(std::lround((node.getPosition().x - gridOrigin.x) / resolution));
+		auto iy = static_cast<int>(std::lround((node.getPosition().y - gridOrigin.y) / resolution));
+		ix = std::max(0, std::min(gridSizeX - 1, ix));
+		iy = std::max(0, std::min(gridSizeY - 1, iy));
+		nodeClusters[node.id] = ix / clusterSize + (iy / clusterSize) * clustersX;
+	}
+	
+	clusterGraph = ThetaStarClusterGraph(*this, std::move(nodeClusters), clustersX * clustersY);
+	ROS_INFO("[Agent %d] Built cluster graph with %d clusters and %d entrances", getOwnerId(), clusterGraph.getClusterCount(), clusterGraph.getEntranceCount());
 	
 	return true;
 }
 
+bool ThetaStarMap::getClusterCorridor(const GridNode* start, const GridNode* target, std::vector<int>& corridor) const {
+	if(clusterGraph.getClusterCount() == 0) {
+		return false;
+	}
+	
+	return clusterGraph.findCorridor(*this, start, target, corridor);
+}
+
+int ThetaStarMap::getCluster(const GridNode* node) const {
+	return clusterGraph.getCluster(node);
+}
+
+int ThetaStarMap::getClusterCount() const {
+	return clusterGraph.getClusterCount();
+}
+
+bool ThetaStarMap::addAdditionalNode(Point pos) {
+	return addAdditionalNodes({pos}) == 1;
+}
+
+int ThetaStarMap::addAdditionalNodes(const std::vector<Point>& positions) {
+	auto previousNodeCount = static_cast<int>(nodes.size());
+	double maxDistance = resolution * resolution;
+	int addedCount = 0;
+	
+	// Links created in this call, indexed by node id. Merged into the CSR arrays afterwards
+	std::vector<std::vector<int>> newLinks(nodes.size());
+	nodes.reserve(nodes.size() + positions.size());
+
+	for(const Point& pos : positions) {
+		if(!map->isPointInMap(pos) || map->isInsideAnyStaticInflatedObstacle(pos)) {
+			continue;
+		}
+		addedCount++;
+
+		// There already exists a node at this exact position
+		if(getNodeIdAt(pos) != -1) {
+			continue;
+		}
+
+		// Collect link candidates: grid nodes from the surrounding cells and additional nodes from the side table
+		std::vector<int> candidates;
+		auto minIx = static_cast<int>(std::floor((pos.x - resolution - gridOrigin.x) / resolution));
+		auto maxIx = static_cast<int>(std::ceil((pos.x + resolution - gridOrigin.x) / resolution));
+		auto minIy = static_cast<int>(std::floor((pos.y - resolution - gridOrigin.y) / resolution));
+		auto maxIy = static_cast<int>(std::ceil((pos.y + resolution - gridOrigin.y) / resolution));
+		for(int ix = minIx; ix <= maxIx; ix++) {
+			for(int iy = minIy; iy <= maxIy; iy++) {
+				int id = getGridNodeId(ix, iy);
+				if(id != -1) {
+					candidates.push_back(id);
+				}
+			}
+		}
+
+		auto first = additionalNodes.lower_bound(Point(pos.x - resolution, std::numeric_limits<double>::lowest()));
+		auto last = additionalNodes.upper_bound(Point(pos.x + resolution, std::numeric_limits<double>::max()));
+		for(auto iter = first; iter != last; iter++) {
+			candidates.push_back(iter->second);
+		}
+		
+		// Link in position order, independent of the storage order
+		Math::PointComparator comparator;
+		std::sort(candidates.begin(), candidates.end(), [&](int a, int b) {
+			return comparator(nodes[a].getPosition(), nodes[b].getPosition());
+		});
+
+		// Add new node
+		auto newId = static_cast<int>(nodes.size());
+		nodes.emplace_back(pos, newId);
+		additionalNodes.emplace(pos, newId);
+		
+		auto ix = static_cast<int>(std::lround((pos.x - gridOrigin.x) / resolution));
+		auto iy = static_cast<int>(std::lround((pos.y - gridOrigin.y) / resolution));
+		additionalNodesByCell[getCellKey(ix, iy)].push_back(newId);
+		newLinks.emplace_back();
+
+		for(int id : candidates) {
+			double distance = Math::getDistanceSquared(nodes[id].getPosition(), pos);
+
+			if(distance <= maxDistance && map->isStaticLineOfSightFree(pos, nodes[id].getPosition())) {
+				newLinks[newId].push_back(id);
+				newLinks[id].push_back(newId);
+			}
+		}
+	}
+
+	// Rebuild CSR arrays: existing explicit neighbours first, new links appended. New nodes have no grid links
+	bool hasNewLinks = static_cast<int>(nodes.size()) != previousNodeCount;
+	if(hasNewLinks) {
+		unsigned long linkCount = neighbourIds.size();
+		for(const std::vector<int>& links : newLinks) {
+			linkCount += links.size();
+		}
+		
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> ids;
+		offsets.reserve(nodes.size() + 1);
+		ids.reserve(linkCount);
+
+		for(int id = 0; id < static_cast<int>(nodes.size()); id++) {
+			offsets.push_back(static_cast<uint32_t>(ids.size()));
+			if(id < previousNodeCount) {
+				ids.insert(ids.end(), neighbourIds.begin() + neighbourOffsets[id], neighbourIds.begin() + neighbourOffsets[id + 1]);
+			}
+			ids.insert(ids.end(), newLinks[id].begin(), newLinks[id].end());
+		}
+		offsets.push_back(static_cast<uint32_t>(ids.size()));
+
+		neighbourOffsets.swap(offsets);
+		neighbourIds.swap(ids);
+		gridLinks.reserve(nodes.size());
+		gridLinks.resize(nodes.size(), 0);
+		
+		if(clusterGraph.getClusterCount() > 0) {
+			buildClusterGraph();
+		}
+	}
+	
+	return addedCount;
+}
+
 int ThetaStarMap::getOwnerId() const {
 	return map->getOwnerId();
 }
 
-std::vector<Rectangle> ThetaStarMap::getRectanglesOnStartingPoint(Point p) const {
-	return map->getRectanglesOnStartingPoint(p);
+std::vector<unsigned long> ThetaStarMap::getReservationIdsOnStartingPoint(Point p) const {
+	return map->getReservationIdsOnStartingPoint(p);
+}
+
+std::vector<std::pair<double, double>> ThetaStarMap::getSafeIntervals(const GridNode* node, double fromTime, const std::vector<unsigned long>& smallerReservationIds) const {
+	return map->getSafeIntervals(node->getPosition(), fromTime, smallerReservationIds);
 }
 
 visualization_msgs::Marker ThetaStarMap::getGridVisualization() {
@@ -134,12 +620,9 @@ visualization_msgs::Marker ThetaStarMap::getGridVisualization() {
 	p.z = 0.f;
 
 	// Nodes
-	int i = 0;
-	for(const auto& node : nodes) {
-		const Point* point = &node.first;
-
-		p.x = point->x;
-		p.y = point->y;
+	for(const GridNode& node : nodes) {
+		p.x = node.getPosition().x;
+		p.y = node.getPosition().y;
 		msg.points.push_back(p);
 	}
 
@@ -171,19 +654,16 @@ visualization_msgs::Marker ThetaStarMap::getLinkVisualization() {
 	p.z = 0.f;
 
 	// Nodes
-	int i = 0;
-	for(const auto& node : nodes) {
-		const Point* start = &node.first;
-
-		for(const auto& neighbour : node.second->neighbours) {
-			const Point* end = &neighbour->pos;
+	for(const GridNode& node : nodes) {
+		for(int neighbourId : getNeighbours(&node)) {
+			Point end = nodes[neighbourId].getPosition();
 
-			p.x = start->x;
-			p.y = start->y;
+			p.x = node.getPosition().x;
+			p.y = node.getPosition().y;
 			msg.points.push_back(p);
 
-			p.x = end->x;
-			p.y = end->y;
+			p.x = end.x;
+			p.y = end.y;
 			msg.points.push_back(p);
 		}
 	}
@@ -0,0 +1,110 @@
+#include <algorithm>
+
+#include "ros/ros.h"
+#include "agent/path_planning/ThetaStarOpenList.h"
+
+const int ThetaStarOpenList::unvisited;
+const int ThetaStarOpenList::closed;
+const int ThetaStarOpenList::arity;
+
+void ThetaStarOpenList::push(ThetaStarGridNodeInformation* node, double key) {
+	ROS_ASSERT(!contains(node));
+
+	heap.emplace_back(key, node);
+	node->heapIndex = static_cast<int>(heap.size()) - 1;
+	siftUp(node->heapIndex);
+}
+
+void ThetaStarOpenList::decreaseKey(ThetaStarGridNodeInformation* node, double key) {
+	ROS_ASSERT(contains(node) && key <= heap[node->heapIndex].first);
+
+	heap[node->heapIndex].first = key;
+	siftUp(node->heapIndex);
+}
+
+void ThetaStarOpenList::update(ThetaStarGridNodeInformation* node, double key) {
+	if(contains(node)) {
+		decreaseKey(node, key);
+	} else {
+		push(node, key);
+	}
+}
+
+ThetaStarGridNodeInformation* ThetaStarOpenList::top() const {
+	return heap.front().second;
+}
+
+void ThetaStarOpenList::pop() {
+	heap.front().second->heapIndex = closed;
+
+	Entry last = heap.back();
+	heap.pop_back();
+	if(!heap.empty()) {
+		place(0, last);
+		siftDown(0);
+	}
+}
+
+bool ThetaStarOpenList::contains(const ThetaStarGridNodeInformation* node) {
+	return node->heapIndex >= 0;
+}
+
+bool ThetaStarOpenList::isClosed(const ThetaStarGridNodeInformation* node) {
+	return node->heapIndex == closed;
+}
+
+bool ThetaStarOpenList::empty() const {
+	return heap.empty();
+}
+
+void ThetaStarOpenList::clear() {
+	heap.clear();
+}
+
+void ThetaStarOpenList::siftUp(int i) {
+	Entry entry = heap[i];
+
+	while(i > 0) {
+		int parent = (i - 1) / arity;
+		if(heap[parent].first <= entry.first) {
+			break;
+		}
+		place(i, heap[parent]);
+		i = parent;
+	}
+
+	place(i, entry);
+}
+
+void ThetaStarOpenList::siftDown(int i) {
+	Entry entry = heap[i];
+	int size = static_cast<int>(heap.size());
+
+	while(true) {
+		int firstChild = i * arity + 1;
+		if(firstChild >= size) {
+			break;
+		}
+
+		int smallestChild = firstChild;
+		int lastChild = std::min(firstChild + arity, size);
+		for(int child = firstChild + 1; child < lastChild; child++) {
+			if(heap[child].first < heap[smallestChild].first) {
+				smallestChild = child;
+			}
+		}
+
+		if(entry.first <= heap[smallestChild].first) {
+			break;
+		}
+		place(i, heap[smallestChild]);
+		i = smallestChild;
+	}
+
+	place(i, entry);
+}
+
+void ThetaStarOpenList::place(int i, const Entry& entry) {
+	heap[i] = entry;
+	entry.second->heapIndex = i;
+}
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <queue>
+#include <limits>
 #include "agent/path_planning/TimedLineOfSightResult.h"
 #include "ros/ros.h"
 #include "Math.h"
@@ -6,14 +8,19 @@
 
 using namespace UncertaintyDirection;
 
-ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations) :
+ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, OrientedPoint target, double startingTime, double targetReservationTime, bool ignoreStartingReservations, TimedSearchMode mode) :
+	ThetaStarPathPlanner(thetaStarMap, hardwareProfile, start, std::vector<OrientedPoint>{target}, startingTime, targetReservationTime, ignoreStartingReservations, mode)
+{}
+
+ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHardwareProfile* hardwareProfile, OrientedPoint start, const std::vector<OrientedPoint>& targets, double startingTime, double targetReservationTime, bool ignoreStartingReservations, TimedSearchMode mode) :
 	map(thetaStarMap),
 	hardwareProfile(hardwareProfile),
 	start(OrientedPoint(start.x, start.y, Math::toDeg(start.o))),
-	target(OrientedPoint(target.x, target.y, Math::toDeg(target.o))),
 	startingTime(startingTime),
 	targetReservationTime(targetReservationTime),
-	timing(startingTime, start, hardwareProfile)
+	timing(startingTime, start, hardwareProfile),
+	mode(mode),
+	reachedGoal(nullptr)
 {
 	isValidPathQuery = true;
 	
@@ -27,27 +34,44 @@ ThetaStarPathPlanner::ThetaStarPathPlanner(ThetaStarMap* thetaStarMap, RobotHard
 	*/
 
 	startNode = map->getNodeClosestTo(Point(start));
-	targetNode = map->getNodeClosestTo(Point(target));
 	
 	if(startNode == nullptr) {
 		ROS_FATAL("[Agent %d] StartPoint %f/%f is not in theta* map!", map->getOwnerId(), start.x, start.y);
 		isValidPathQuery = false;
 	}
-	if(targetNode == nullptr) {
-		ROS_FATAL("[Agent %d] TargetPoint %f/%f is not in theta* map!", map->getOwnerId(), target.x, target.y);
+	
+	for(int i = 0; i < static_cast<int>(targets.size()); i++) {
+		const OrientedPoint& target = targets[i];
+		const GridNode* targetNode = map->getNodeClosestTo(Point(target));
+		if(targetNode == nullptr) {
+			ROS_FATAL("[Agent %d] TargetPoint %f/%f is not in theta* map!", map->getOwnerId(), target.x, target.y);
+			continue;
+		}
+		
+		const std::vector<float>* targetDistances = map->getLandmarkDistances(targetNode);
+		
+		// Theta* only moves along node links, a target which is not linked to the start can never be reached
+		if(startNode != nullptr && targetDistances != nullptr && (*targetDistances)[startNode->id] == std::numeric_limits<float>::max()) {
+			continue;
+		}
+		
+		goals.push_back(Goal{OrientedPoint(target.x, target.y, Math::toDeg(target.o)), targetNode, targetDistances, i});
+	}
+	
+	if(goals.empty()) {
 		isValidPathQuery = false;
-	}	
+	}
 
 	double initialWaitTime = 0;
 	// Use empty vector here
-	smallerReservations.clear();
-	TimedLineOfSightResult initialCheckResult = map->whenIsTimedLineOfSightFree(startNode->pos, startingTime, startNode->pos, startingTime + 1.1f, smallerReservations);
+	smallerReservationIds.clear();
+	TimedLineOfSightResult initialCheckResult = map->whenIsTimedLineOfSightFree(startNode->getPosition(), startingTime, startNode->getPosition(), startingTime + 1.1f, smallerReservationIds);
 	if(initialCheckResult.blockedByTimed) {
 		initialWaitTime = initialCheckResult.freeAfter - (startingTime + 0.1f);
 
 		if(ignoreStartingReservations) {
-			smallerReservations = map->getRectanglesOnStartingPoint(startNode->pos);
-			ROS_WARN("[Agent %d] Initial wait time of %f. Using %d smaller reservations instead!", map->getOwnerId(), initialWaitTime, (int) smallerReservations.size());	
+			smallerReservationIds = map->getReservationIdsOnStartingPoint(startNode->getPosition());
+			ROS_WARN("[Agent %d] Initial wait time of %f. Using %d smaller reservations instead!", map->getOwnerId(), initialWaitTime, (int) smallerReservationIds.size());	
 		} else {
 			//ROS_WARN("[Agent %d] Path would need initial wait time of %f", map->getOwnerId(), initialWaitTime);
 			isValidPathQuery = false;
@@ -60,35 +84,72 @@ Path ThetaStarPathPlanner::findPath() {
 		return Path();
 	}
 	
-	if(start.x == target.x && start.y == target.y) {
-		return Path(startingTime, {Point(start), Point(start)}, {0.0, 0.0}, hardwareProfile, targetReservationTime, start, start, map->getOwnerId());
+	for(const Goal& goal : goals) {
+		if(start.x == goal.target.x && start.y == goal.target.y) {
+			reachedGoal = &goal;
+			return Path(startingTime, {Point(start), Point(start)}, {0.0, 0.0}, hardwareProfile, targetReservationTime, start, start, map->getOwnerId());
+		}
 	}
 	
-	GridInformationMap exploredSet;
-	GridInformationPairQueue queue;
+	if(mode == TimedSearchMode::SafeIntervals) {
+		return findPathWithSafeIntervals();
+	}
+	return findPathWithWaitTimes();
+}
+
+Path ThetaStarPathPlanner::findPathWithWaitTimes() {
+	std::unique_ptr<ThetaStarSearchArena> arena = map->acquireSearchArena();
+	Path path;
+	
+	// On large maps, first refine only the clusters along the abstract path. Reservations can block the corridor, then the whole map is searched
+	auto search = [&]() {
+		return mode == TimedSearchMode::LazyWaitTimes ? searchWithLazyLineOfSight(*arena) : searchWithWaitTimes(*arena);
+	};
+	
+	std::vector<int> corridor;
+	if(goals.size() == 1 && map->getClusterCorridor(startNode, goals.front().node, corridor)) {
+		arena->setCorridor(corridor, map->getClusterCount());
+		path = search();
+		arena->reset(map->getNodeCount());
+	}
+	
+	if(!path.isValid()) {
+		path = search();
+	}
+	
+	map->releaseSearchArena(std::move(arena));
+	return path;
+}
+
+Path ThetaStarPathPlanner::searchWithWaitTimes(ThetaStarSearchArena& arena) {
+	ThetaStarOpenList& openList = arena.getOpenList();
 
 	// Push start node
-	exploredSet.insert(std::make_pair(startNode->pos, ThetaStarGridNodeInformation(startNode, nullptr, startingTime)));
-	queue.push(std::make_pair(startingTime, &exploredSet.at(startNode->pos)));
+	openList.push(arena.getInformation(startNode, startingTime), startingTime);
 
 	bool targetFound = false;
 	ThetaStarGridNodeInformation* targetInformation = nullptr;
 
-	while(!queue.empty()) {
-		ThetaStarGridNodeInformation* current = queue.top().second;
+	while(!openList.empty()) {
+		ThetaStarGridNodeInformation* current = openList.top();
 		ThetaStarGridNodeInformation* prev = current->prev;
-		queue.pop();
+		openList.pop();
 
 		// Target found
-		if(current->node == targetNode) {
+		reachedGoal = getGoal(current->node);
+		if(reachedGoal != nullptr) {
 			targetFound = true;
 			targetInformation = current;
 			break;
 		}
 
 		// Explore all neighbours		
-		for(auto neighbourNode : current->node->neighbours) {
-			ThetaStarGridNodeInformation* neighbour = &exploredSet.insert(std::make_pair(neighbourNode->pos, ThetaStarGridNodeInformation(neighbourNode, nullptr, initialTime))).first->second;
+		for(int neighbourId : map->getNeighbours(current->node)) {
+			const GridNode* neighbourNode = map->getNode(neighbourId);
+			if(arena.hasCorridor() && !arena.isInCorridor(map->getCluster(neighbourNode))) {
+				continue;
+			}
+			ThetaStarGridNodeInformation* neighbour = arena.getInformation(neighbourNode, initialTime);
 
 			// Driving time only includes the additional time to drive from newPrev to neighbour.
 			// Therefore: newPrev->time + drivingTime + waitingTime = neighbour->time must be true!
@@ -103,107 +164,371 @@ Path ThetaStarPathPlanner::findPath() {
 			bool makeConnection = false;
 
 			// Only try direct connection with prev if not at start node (prev != nullptr) AND not blocked by timed obstacle
-			bool prevNotNull = prev != nullptr;
-			bool connectionWithPrevPossible = false;
-			if(prevNotNull) {
-				double timeAtPrev = prev->time;
-				timeAtPrev -= timing.getPlanningUncertainty(timeAtPrev, Direction::BEHIND);
-				double timeAtNeighbour = prev->time + timing.getDrivingAndTurningTime(prev, neighbour);
-				timeAtNeighbour += timing.getPlanningUncertainty(timeAtNeighbour, Direction::AHEAD);
-
-				TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(prev->node->pos, timeAtPrev, neighbour->node->pos, timeAtNeighbour, smallerReservations);
-				
-				connectionWithPrevPossible = !result.blockedByStatic && !result.blockedByTimed && (!result.hasUpcomingObstacle || (result.hasUpcomingObstacle && timeAtNeighbour < result.lastValidEntryTime));
-			}
-
-			if(prevNotNull && connectionWithPrevPossible) {
+			if(prev != nullptr && isConnectionWithoutWaitingPossible(prev, neighbour)) {
 				drivingTime = timing.getDrivingAndTurningTime(prev, neighbour);
 				newPrev = prev;
 				makeConnection = true;
-			} else {
+			} else if(getWaitingTime(current, neighbour, waitingTime)) {
 				// If no direct connection possible, try to connect via current
-				double timeAtCurrent = current->time;
-				timeAtCurrent -= timing.getPlanningUncertainty(timeAtCurrent, Direction::BEHIND);
-				double timeAtNeighbour = current->time + timing.getDrivingAndTurningTime(current, neighbour);
-				timeAtNeighbour += timing.getPlanningUncertainty(timeAtNeighbour, Direction::AHEAD);
-				TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(current->node->pos, timeAtCurrent, neighbour->node->pos, timeAtNeighbour, smallerReservations);
-
-				if(!result.blockedByStatic) {
-					bool waitBecauseUpcomingObstacle = result.hasUpcomingObstacle && timeAtNeighbour >= result.lastValidEntryTime;
-
-					if(!result.blockedByTimed && !waitBecauseUpcomingObstacle) {
-						drivingTime = timing.getDrivingAndTurningTime(current, neighbour);
-						newPrev = current;
-						makeConnection = true;
-					} else {
-						// Calculate wait time
-						if(waitBecauseUpcomingObstacle) {
-							waitingTime = result.freeAfterUpcomingObstacle - current->time;
-						} else {
-							waitingTime = result.freeAfter - current->time;
-						}
-						waitingTime = std::max(0.0, waitingTime);
-						//waitingTime += timing.getRelativeUncertainty(waitingTime);
-
-						drivingTime = timing.getDrivingAndTurningTime(current, neighbour);
-						newPrev = current;
-						makeConnection = true;
-					}
-				}
+				drivingTime = timing.getDrivingAndTurningTime(current, neighbour);
+				newPrev = current;
+				makeConnection = true;
 			}
 
 			// Finally try to make connection
 			if(makeConnection && (newPrev->time + drivingTime + waitingTime) < neighbour->time) {
 				// Check for if connection is valid for upcoming obstacles
-				if(map->isTimedConnectionFree(newPrev->node->pos, neighbour->node->pos, newPrev->time, waitingTime, drivingTime, smallerReservations)) {
-					double heuristic = getHeuristic(neighbour, targetNode->pos);
+				bool isConnectionFree = map->isTimedConnectionFree(newPrev->node->getPosition(), neighbour->node->getPosition(), newPrev->time, waitingTime, drivingTime, smallerReservationIds);
+				if(!isConnectionFree && postponeConnection(newPrev, neighbour, drivingTime, waitingTime)) {
+					// The longer wait may make this connection slower than the one the neighbour already has
+					isConnectionFree = newPrev->time + drivingTime + waitingTime < neighbour->time && map->isTimedConnectionFree(newPrev->node->getPosition(), neighbour->node->getPosition(), newPrev->time, waitingTime, drivingTime, smallerReservationIds);
+				}
+				
+				if(isConnectionFree) {
+					double heuristic = getHeuristic(neighbour);
 
 					neighbour->time = newPrev->time + drivingTime + waitingTime;
 					neighbour->prev = newPrev;
 					neighbour->waitTimeAtPrev = waitingTime;
-					queue.push(std::make_pair(neighbour->time + heuristic, neighbour));
-				} else {
-					TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(newPrev->node->pos, newPrev->time, neighbour->node->pos, newPrev->time + waitingTime + drivingTime, smallerReservations);
-					
-					if(!result.blockedByStatic && result.blockedByTimed) {
-						double newWaitingTime = result.freeAfter - newPrev->time;
-						waitingTime = std::max(waitingTime, newWaitingTime);
-
-						if(map->isTimedConnectionFree(newPrev->node->pos, neighbour->node->pos, newPrev->time, waitingTime, drivingTime, smallerReservations)) {
-							double heuristic = getHeuristic(neighbour, targetNode->pos);
-
-							neighbour->time = newPrev->time + drivingTime + waitingTime;
-							neighbour->prev = newPrev;
-							neighbour->waitTimeAtPrev = waitingTime;
-							queue.push(std::make_pair(neighbour->time + heuristic, neighbour));
-							//ROS_INFO("[Agent %d] Made connection only after second attempt", map->getOwnerId());
-						}
-					}
+					openList.update(neighbour, neighbour->time + heuristic);
 				}
 			}
 		}
 	}
 
+	Path path;
 	if(targetFound) {
-		Path path = constructPath(startingTime, targetInformation, targetReservationTime);
-		return smoothPath(path);
+		path = smoothPath(constructPath(startingTime, targetInformation, targetReservationTime));
 	} else {
-		//ROS_WARN("[Agent %d] No path found from node %f/%f to node %f/%f!", map->getOwnerId(), startNode->pos.x,startNode->pos.y, targetNode->pos.x, targetNode->pos.y);
+		//ROS_WARN("[Agent %d] No path found from node %f/%f to node %f/%f!", map->getOwnerId(), startNode->getPosition().x,startNode->getPosition().y, goals.front().node->getPosition().x, goals.front().node->getPosition().y);
 		//ROS_WARN("Reservations for start:");
-		//map->listAllReservationsIn(startNode->pos);
+		//map->listAllReservationsIn(startNode->getPosition());
 
 		//ROS_WARN("Reservations for target:");
-		//map->listAllReservationsIn(targetNode->pos);
+		//map->listAllReservationsIn(goals.front().node->getPosition());
+	}
+
+	return path;
+}
+
+Path ThetaStarPathPlanner::searchWithLazyLineOfSight(ThetaStarSearchArena& arena) {
+	ThetaStarOpenList& openList = arena.getOpenList();
+	openList.push(arena.getInformation(startNode, startingTime), startingTime);
+
+	ThetaStarGridNodeInformation* targetInformation = nullptr;
+
+	while(!openList.empty()) {
+		ThetaStarGridNodeInformation* current = openList.top();
+		openList.pop();
+
+		// The connection from prev was only assumed to be free. If it is not, take the best connection from an expanded neighbour instead
+		if(current->prev != nullptr && !isConnectionWithoutWaitingFree(current->prev, current) && !connectToExpandedNeighbour(arena, current)) {
+			// Closed nodes are never reopened, so the node stays unreachable during this search
+			current->time = initialTime;
+			current->prev = nullptr;
+			continue;
+		}
+
+		reachedGoal = getGoal(current->node);
+		if(reachedGoal != nullptr) {
+			targetInformation = current;
+			break;
+		}
+
+		// Neighbours are optimistically connected to prev without waiting
+		ThetaStarGridNodeInformation* newPrev = current->prev != nullptr ? current->prev : current;
+		for(int neighbourId : map->getNeighbours(current->node)) {
+			const GridNode* neighbourNode = map->getNode(neighbourId);
+			if(arena.hasCorridor() && !arena.isInCorridor(map->getCluster(neighbourNode))) {
+				continue;
+			}
+			ThetaStarGridNodeInformation* neighbour = arena.getInformation(neighbourNode, initialTime);
+			if(ThetaStarOpenList::isClosed(neighbour)) {
+				continue;
+			}
+
+			double time = newPrev->time + timing.getDrivingAndTurningTime(newPrev, neighbour);
+			if(time < neighbour->time) {
+				neighbour->time = time;
+				neighbour->prev = newPrev;
+				neighbour->waitTimeAtPrev = 0;
+				openList.update(neighbour, time + getHeuristic(neighbour));
+			}
+		}
+	}
+
+	if(targetInformation == nullptr) {
+		return Path();
+	}
+
+	return smoothPath(constructPath(startingTime, targetInformation, targetReservationTime));
+}
+
+bool ThetaStarPathPlanner::connectToExpandedNeighbour(ThetaStarSearchArena& arena, ThetaStarGridNodeInformation* node) {
+	ThetaStarGridNodeInformation* bestPrev = nullptr;
+	double bestTime = initialTime;
+	double bestWaitingTime = 0;
+
+	for(int neighbourId : map->getNeighbours(node->node)) {
+		const GridNode* neighbourNode = map->getNode(neighbourId);
+		if(arena.hasCorridor() && !arena.isInCorridor(map->getCluster(neighbourNode))) {
+			continue;
+		}
+		ThetaStarGridNodeInformation* neighbour = arena.getInformation(neighbourNode, initialTime);
+
+		// Unreachable nodes are closed as well
+		double waitingTime = 0;
+		if(!ThetaStarOpenList::isClosed(neighbour) || neighbour->time == initialTime || !getWaitingTime(neighbour, node, waitingTime)) {
+			continue;
+		}
+
+		double drivingTime = timing.getDrivingAndTurningTime(neighbour, node);
+		bool isConnectionFree = map->isTimedConnectionFree(neighbour->node->getPosition(), node->node->getPosition(), neighbour->time, waitingTime, drivingTime, smallerReservationIds);
+		if(!isConnectionFree && postponeConnection(neighbour, node, drivingTime, waitingTime)) {
+			isConnectionFree = map->isTimedConnectionFree(neighbour->node->getPosition(), node->node->getPosition(), neighbour->time, waitingTime, drivingTime, smallerReservationIds);
+		}
+
+		if(isConnectionFree && neighbour->time + drivingTime + waitingTime < bestTime) {
+			bestPrev = neighbour;
+			bestTime = neighbour->time + drivingTime + waitingTime;
+			bestWaitingTime = waitingTime;
+		}
+	}
+
+	if(bestPrev == nullptr) {
+		return false;
+	}
+
+	node->time = bestTime;
+	node->prev = bestPrev;
+	node->waitTimeAtPrev = bestWaitingTime;
+	return true;
+}
+
+bool ThetaStarPathPlanner::isConnectionWithoutWaitingPossible(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to) const {
+	double timeAtFrom = from->time;
+	timeAtFrom -= timing.getPlanningUncertainty(timeAtFrom, Direction::BEHIND);
+	double timeAtTo = from->time + timing.getDrivingAndTurningTime(from, to);
+	timeAtTo += timing.getPlanningUncertainty(timeAtTo, Direction::AHEAD);
+
+	TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(from->node, timeAtFrom, to->node, timeAtTo, smallerReservationIds);
+
+	return !result.blockedByStatic && !result.blockedByTimed && (!result.hasUpcomingObstacle || (result.hasUpcomingObstacle && timeAtTo < result.lastValidEntryTime));
+}
+
+bool ThetaStarPathPlanner::isConnectionWithoutWaitingFree(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to) const {
+	if(!isConnectionWithoutWaitingPossible(from, to)) {
+		return false;
+	}
+
+	return map->isTimedConnectionFree(from->node->getPosition(), to->node->getPosition(), from->time, 0, timing.getDrivingAndTurningTime(from, to), smallerReservationIds);
+}
+
+bool ThetaStarPathPlanner::getWaitingTime(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to, double& waitingTime) const {
+	double timeAtFrom = from->time;
+	timeAtFrom -= timing.getPlanningUncertainty(timeAtFrom, Direction::BEHIND);
+	double timeAtTo = from->time + timing.getDrivingAndTurningTime(from, to);
+	timeAtTo += timing.getPlanningUncertainty(timeAtTo, Direction::AHEAD);
+	TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(from->node, timeAtFrom, to->node, timeAtTo, smallerReservationIds);
+
+	if(result.blockedByStatic) {
+		return false;
+	}
+
+	bool waitBecauseUpcomingObstacle = result.hasUpcomingObstacle && timeAtTo >= result.lastValidEntryTime;
+	if(!result.blockedByTimed && !waitBecauseUpcomingObstacle) {
+		waitingTime = 0;
+	} else {
+		// Calculate wait time
+		if(waitBecauseUpcomingObstacle) {
+			waitingTime = result.freeAfterUpcomingObstacle - from->time;
+		} else {
+			waitingTime = result.freeAfter - from->time;
+		}
+		waitingTime = std::max(0.0, waitingTime);
+		//waitingTime += timing.getRelativeUncertainty(waitingTime);
+	}
+
+	return true;
+}
+
+bool ThetaStarPathPlanner::postponeConnection(ThetaStarGridNodeInformation* from, ThetaStarGridNodeInformation* to, double drivingTime, double& waitingTime) const {
+	TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(from->node, from->time, to->node, from->time + waitingTime + drivingTime, smallerReservationIds);
+
+	if(result.blockedByStatic || !result.blockedByTimed) {
+		return false;
+	}
+
+	waitingTime = std::max(waitingTime, result.freeAfter - from->time);
+	return true;
+}
 
+Path ThetaStarPathPlanner::findPathWithSafeIntervals() {
+	const std::vector<SafeInterval>& startIntervals = getSafeIntervals(startNode);
+	auto startInterval = std::find_if(startIntervals.begin(), startIntervals.end(), [&](const SafeInterval& interval) {
+		return interval.first <= startingTime && startingTime < interval.second;
+	});
+	if(startInterval == startIntervals.end()) {
 		return Path();
 	}
+	
+	// Search states are (node, safe interval) pairs. The turning time of a connection depends on prev, so states are never modified once they have been pushed.
+	// An improved state is added as a new state which replaces the old one in the lookup. A deque keeps the prev pointers valid while states are added
+	std::deque<ThetaStarGridNodeInformation> states;
+	std::unordered_map<uint64_t, ThetaStarGridNodeInformation*> stateLookup;
+	GridInformationPairQueue queue;
+	
+	auto getStateKey = [](const GridNode* node, int interval) {
+		return (static_cast<uint64_t>(node->id) << 32) | static_cast<uint32_t>(interval);
+	};
+	
+	states.emplace_back(startNode, nullptr, startingTime);
+	states.back().safeInterval = static_cast<int>(startInterval - startIntervals.begin());
+	stateLookup[getStateKey(startNode, states.back().safeInterval)] = &states.back();
+	queue.push(std::make_pair(startingTime, &states.back()));
+	
+	ThetaStarGridNodeInformation* targetInformation = nullptr;
+	std::vector<std::tuple<int, double, double>> arrivals;
+	
+	while(!queue.empty()) {
+		ThetaStarGridNodeInformation* current = queue.top().second;
+		queue.pop();
+		
+		// Skip states which were replaced by an improved state after they had been pushed
+		if(stateLookup[getStateKey(current->node, current->safeInterval)] != current) {
+			continue;
+		}
+		
+		double currentIntervalEnd = getSafeIntervals(current->node)[current->safeInterval].second;
+		
+		// The target has to stay free while the target reservation lasts
+		const Goal* goal = getGoal(current->node);
+		if(goal != nullptr && currentIntervalEnd >= current->time + targetReservationTime) {
+			reachedGoal = goal;
+			targetInformation = current;
+			break;
+		}
+		
+		for(int neighbourId : map->getNeighbours(current->node)) {
+			const GridNode* neighbourNode = map->getNode(neighbourId);
+			
+			// Like Theta*, try to connect the neighbour directly to prev first. Connections via current are tried as well because they may reach other intervals
+			for(ThetaStarGridNodeInformation* from : {current->prev, current}) {
+				if(from == nullptr) {
+					continue;
+				}
+				
+				double fromIntervalEnd = getSafeIntervals(from->node)[from->safeInterval].second;
+				arrivals.clear();
+				getSafeIntervalArrivals(from, fromIntervalEnd, neighbourNode, arrivals);
+				
+				for(const auto& arrival : arrivals) {
+					int interval = std::get<0>(arrival);
+					double arrivalTime = std::get<1>(arrival);
+					
+					ThetaStarGridNodeInformation*& neighbour = stateLookup[getStateKey(neighbourNode, interval)];
+					if(neighbour == nullptr || arrivalTime < neighbour->time) {
+						states.emplace_back(neighbourNode, from, arrivalTime);
+						neighbour = &states.back();
+						neighbour->safeInterval = interval;
+						neighbour->waitTimeAtPrev = std::get<2>(arrival);
+						queue.push(std::make_pair(neighbour->time + getHeuristic(neighbour), neighbour));
+					}
+				}
+				
+				if(from == current->prev && !arrivals.empty() && std::get<2>(arrivals.front()) == 0) {
+					break;
+				}
+			}
+		}
+	}
+	
+	if(targetInformation == nullptr) {
+		return Path();
+	}
+	
+	Path path = constructPath(startingTime, targetInformation, targetReservationTime);
+	return smoothPath(path);
+}
+
+const std::vector<ThetaStarPathPlanner::SafeInterval>& ThetaStarPathPlanner::getSafeIntervals(const GridNode* node) {
+	auto iter = safeIntervals.find(node->id);
+	if(iter == safeIntervals.end()) {
+		iter = safeIntervals.emplace(node->id, map->getSafeIntervals(node, startingTime, smallerReservationIds)).first;
+	}
+	return iter->second;
+}
+
+void ThetaStarPathPlanner::getSafeIntervalArrivals(ThetaStarGridNodeInformation* from, double fromIntervalEnd, const GridNode* neighbour, std::vector<std::tuple<int, double, double>>& arrivals) {
+	ThetaStarGridNodeInformation neighbourInformation(neighbour, nullptr, initialTime);
+	double drivingTime = timing.getDrivingAndTurningTime(from, &neighbourInformation);
+	
+	const std::vector<SafeInterval>& intervals = getSafeIntervals(neighbour);
+	for(int i = 0; i < static_cast<int>(intervals.size()); i++) {
+		if(intervals[i].second <= from->time + drivingTime) {
+			continue;
+		}
+		
+		// Wait at from as long as necessary, but leave before its safe interval ends
+		double departureTime = std::max(from->time, intervals[i].first - drivingTime);
+		for(int attempt = 0; attempt < maxConnectionPostponements; attempt++) {
+			if(departureTime >= fromIntervalEnd) {
+				// Later intervals need even later departures
+				return;
+			}
+			
+			double arrivalTime = departureTime + drivingTime;
+			if(arrivalTime >= intervals[i].second) {
+				break;
+			}
+			
+			TimedLineOfSightResult result = map->whenIsTimedLineOfSightFree(from->node, departureTime, neighbour, arrivalTime, smallerReservationIds);
+			if(result.blockedByStatic) {
+				return;
+			}
+			
+			if(!result.blockedByTimed) {
+				arrivals.emplace_back(i, arrivalTime, departureTime - from->time);
+				break;
+			}
+			
+			departureTime = std::max(departureTime + 0.01f, result.freeAfter);
+		}
+	}
+}
+
+double ThetaStarPathPlanner::getHeuristic(ThetaStarGridNodeInformation* current) const {
+	double lowestDistance = std::numeric_limits<double>::max();
+	
+	for(const Goal& goal : goals) {
+		double distance = Math::getDistance(current->node->getPosition(), goal.node->getPosition());
+		
+		// Shortest distance around the static obstacles, never longer than the remaining path
+		if(goal.distances != nullptr) {
+			distance = std::max(distance, static_cast<double>((*goal.distances)[current->node->id]));
+		}
+		
+		lowestDistance = std::min(lowestDistance, distance);
+	}
+	
+	return hardwareProfile->getDrivingDuration(lowestDistance);
+}
+
+const ThetaStarPathPlanner::Goal* ThetaStarPathPlanner::getGoal(const GridNode* node) const {
+	for(const Goal& goal : goals) {
+		if(goal.node == node) {
+			return &goal;
+		}
+	}
+	return nullptr;
 }
 
-double ThetaStarPathPlanner::getHeuristic(ThetaStarGridNodeInformation* current, Point targetPos) const {
-	return hardwareProfile->getDrivingDuration(Math::getDistance(current->node->pos, targetPos));
+int ThetaStarPathPlanner::getReachedTargetIndex() const {
+	return reachedGoal != nullptr ? reachedGoal->index : -1;
 }
 
 Path ThetaStarPathPlanner::constructPath(double startingTime, ThetaStarGridNodeInformation* targetInformation, double targetReservationTime) const {
+	const OrientedPoint& target = reachedGoal->target;
 	std::vector<Point> pathNodes;
 	std::vector<double> waitTimes;
 	ThetaStarGridNodeInformation* currentGridInformation = targetInformation;
@@ -211,7 +536,7 @@ Path ThetaStarPathPlanner::constructPath(double startingTime, ThetaStarGridNodeI
 	
 	int i = 0;
 	while(currentGridInformation != nullptr) {
-		pathNodes.emplace_back(currentGridInformation->node->pos);
+		pathNodes.emplace_back(currentGridInformation->node->getPosition());
 		waitTimes.push_back(waitTimeAtPrev);
 
 		waitTimeAtPrev = currentGridInformation->waitTimeAtPrev;
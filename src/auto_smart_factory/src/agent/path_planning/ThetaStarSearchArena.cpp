@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include "agent/path_planning/ThetaStarSearchArena.h"
+
+ThetaStarSearchArena::ThetaStarSearchArena() :
+	generation(0),
+	corridorActive(false)
+{}
+
+void ThetaStarSearchArena::reset(int nodeCount) {
+	if(static_cast<int>(information.size()) < nodeCount) {
+		information.resize(nodeCount, ThetaStarGridNodeInformation(nullptr, nullptr, 0));
+		generations.resize(nodeCount, 0);
+	}
+
+	// Entries are marked with the generation they were written in. After an overflow old marks could match again
+	generation++;
+	if(generation == 0) {
+		std::fill(generations.begin(), generations.end(), 0);
+		std::fill(corridorGenerations.begin(), corridorGenerations.end(), 0);
+		generation = 1;
+	}
+
+	corridorActive = false;
+	openList.clear();
+}
+
+ThetaStarGridNodeInformation* ThetaStarSearchArena::getInformation(const GridNode* node, double initialTime) {
+	ThetaStarGridNodeInformation& nodeInformation = information[node->id];
+	if(generations[node->id] != generation) {
+		generations[node->id] = generation;
+		nodeInformation = ThetaStarGridNodeInformation(node, nullptr, initialTime);
+	}
+	return &nodeInformation;
+}
+
+void ThetaStarSearchArena::setCorridor(const std::vector<int>& clusters, int clusterCount) {
+	if(static_cast<int>(corridorGenerations.size()) < clusterCount) {
+		corridorGenerations.resize(clusterCount, 0);
+	}
+
+	for(int cluster : clusters) {
+		corridorGenerations[cluster] = generation;
+	}
+	corridorActive = true;
+}
+
+bool ThetaStarSearchArena::hasCorridor() const {
+	return corridorActive;
+}
+
+bool ThetaStarSearchArena::isInCorridor(int cluster) const {
+	return corridorGenerations[cluster] == generation;
+}
+
+ThetaStarOpenList& ThetaStarSearchArena::getOpenList() {
+	return openList;
+}
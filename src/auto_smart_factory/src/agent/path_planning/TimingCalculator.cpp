@@ -40,12 +40,12 @@ double TimingCalculator::getDrivingAndTurningTime(ThetaStarGridNodeInformation*
 
 	// Include turningTime to current line segment if prev is available
 	if(current->prev != nullptr) {
-		turningTime = getTurningTime(current->prev->node->pos, current->node->pos, target->node->pos);
+		turningTime = getTurningTime(current->prev->node->getPosition(), current->node->getPosition(), target->node->getPosition());
 	} else {
-		turningTime = getTurningTime(startPoint.o, current->node->pos, target->node->pos);
+		turningTime = getTurningTime(startPoint.o, current->node->getPosition(), target->node->getPosition());
 	}
 
-	return turningTime + hardwareProfile->getDrivingDuration(Math::getDistance(current->node->pos, target->node->pos));
+	return turningTime + hardwareProfile->getDrivingDuration(Math::getDistance(current->node->getPosition(), target->node->getPosition()));
 }
 
 double TimingCalculator::getTurningTime(Point prev, Point curr, Point next) const {
@@ -9,7 +9,8 @@ TaskHandler::TaskHandler(Agent* agent, ros::Publisher* scorePub, ros::Publisher*
 	motionPlanner(mp),
 	gripper(gripper),
 	chargingManagement(cm),
-	reservationManager(rm)
+	reservationManager(rm),
+	announcementPool(announcementThreadCount)
 {
 }
 
@@ -331,53 +332,70 @@ void TaskHandler::answerAnnouncement(auto_smart_factory::TaskAnnouncement& taskA
 	double estimatedBatteryAfterQueuedTasks = getEstimatedBatteryLevelAfterQueuedTasks();
 	Task* lastTask = getLastTask();
 	
+	// Everything the workers need is collected here, the workers only plan paths on the map.
+	// The map is not modified while the workers run because reservation callbacks are only handled by this thread
+	OrientedPoint startPosition = lastTask != nullptr ? lastTask->getTargetPosition() : agent->getCurrentOrientedPosition();
+	double startTime = lastTask != nullptr ? lastTask->getEndTime() : ros::Time::now().toSec();
+	
+	std::vector<auto_smart_factory::Tray> inputTrays;
+	for(uint32_t it_id : taskAnnouncement.start_ids) {
+		inputTrays.push_back(agent->getTray(it_id));
+	}
+	std::vector<auto_smart_factory::Tray> storageTrays;
+	for(uint32_t st_id : taskAnnouncement.end_ids) {
+		storageTrays.push_back(agent->getTray(st_id));
+	}
+	
+	// The path to the source tray does not depend on the target tray, so it is only planned once per source tray
+	std::vector<Path> sourcePaths(inputTrays.size());
+	announcementPool.parallelFor(static_cast<int>(inputTrays.size()), [&](int i) {
+		sourcePaths[i] = map->getThetaStarPath(startPosition, inputTrays[i], startTime, TransportationTask::getPickUpTime());
+	});
+	
+	std::vector<std::pair<int, int>> candidatePairs;
+	for(int i = 0; i < static_cast<int>(inputTrays.size()); i++) {
+		if(sourcePaths[i].isValid()) {
+			for(int j = 0; j < static_cast<int>(storageTrays.size()); j++) {
+				candidatePairs.emplace_back(i, j);
+			}
+		}
+	}
+	
+	std::vector<Path> targetPaths(candidatePairs.size());
+	announcementPool.parallelFor(static_cast<int>(candidatePairs.size()), [&](int k) {
+		const Path& sourcePath = sourcePaths[candidatePairs[k].first];
+		double targetStartTime = startTime + sourcePath.getDuration() + TransportationTask::getPickUpTime();
+		targetPaths[k] = map->getThetaStarPath(inputTrays[candidatePairs[k].first], storageTrays[candidatePairs[k].second], targetStartTime, TransportationTask::getDropOffTime());
+	});
+	
+	// Reduce in the order of the announcement so that ties are resolved like in a serial evaluation
 	TrayScore* best = nullptr;
+	for(unsigned long k = 0; k < candidatePairs.size(); k++) {
+		const Path& sourcePath = sourcePaths[candidatePairs[k].first];
+		const Path& targetPath = targetPaths[k];
+		uint32_t it_id = taskAnnouncement.start_ids[candidatePairs[k].first];
+		uint32_t st_id = taskAnnouncement.end_ids[candidatePairs[k].second];
+		
+		if(!targetPath.isValid()) {
+			continue;
+		}
+		
+		double estimatedNewConsumption = sourcePath.getBatteryConsumption() + targetPath.getBatteryConsumption();
 
-	for(uint32_t it_id : taskAnnouncement.start_ids){
-		for(uint32_t st_id : taskAnnouncement.end_ids){
-			// get Path
-			auto_smart_factory::Tray input_tray = agent->getTray(it_id);
-			auto_smart_factory::Tray storage_tray = agent->getTray(st_id);
-			Path sourcePath;
-			double startTime;
-			
-			if(lastTask != nullptr){
-				// take the last position of the last task
-				startTime = lastTask->getEndTime();
-				sourcePath = map->getThetaStarPath(lastTask->getTargetPosition(), input_tray, startTime, TransportationTask::getPickUpTime());
-			} else {
-				// take the current position
-				startTime = ros::Time::now().toSec();
-				sourcePath = map->getThetaStarPath(agent->getCurrentOrientedPosition(), input_tray, startTime, TransportationTask::getPickUpTime());
-			}
+		// Check if task can be completed
+		if(chargingManagement->isConsumptionPossible(estimatedBatteryAfterQueuedTasks, estimatedNewConsumption)) {
+			double duration = queuedDuration + sourcePath.getDuration() + targetPath.getDuration();
+			double scoreFactor = chargingManagement->getScoreMultiplierForBatteryLevel(estimatedBatteryAfterQueuedTasks - estimatedNewConsumption);
+			double score = (1.f / scoreFactor) * duration;
 			
-			if(!sourcePath.isValid()){
-				continue;
-			}
-			
-			Path targetPath = map->getThetaStarPath(input_tray, storage_tray, startTime + sourcePath.getDuration() + TransportationTask::getPickUpTime(), TransportationTask::getDropOffTime());
+			// add score to list
+			double estimatedDuration = sourcePath.getDuration() + targetPath.getDuration();
+			ROS_ASSERT_MSG(estimatedDuration > 0, "source-duration: %f | target-duration: %f", sourcePath.getDuration(), targetPath.getDuration());
 			
-			if(!targetPath.isValid()) {
-				continue;
-			}
-			
-			double estimatedNewConsumption = sourcePath.getBatteryConsumption() + targetPath.getBatteryConsumption();
-
-			// Check if task can be completed
-			if(chargingManagement->isConsumptionPossible(estimatedBatteryAfterQueuedTasks, estimatedNewConsumption)) {
-				double duration = queuedDuration + sourcePath.getDuration() + targetPath.getDuration();
-				double scoreFactor = chargingManagement->getScoreMultiplierForBatteryLevel(estimatedBatteryAfterQueuedTasks - estimatedNewConsumption);
-				double score = (1.f / scoreFactor) * duration;
-				
-				// add score to list
-				double estimatedDuration = sourcePath.getDuration() + targetPath.getDuration();
-				ROS_ASSERT_MSG(estimatedDuration > 0, "source-duration: %f | target-duration: %f", sourcePath.getDuration(), targetPath.getDuration());
-				
-				// Update best score
-				if(best == nullptr || score < best->score){
-					delete best;
-					best = new TrayScore(it_id, st_id, score, estimatedDuration);
-				}
+			// Update best score
+			if(best == nullptr || score < best->score){
+				delete best;
+				best = new TrayScore(it_id, st_id, score, estimatedDuration);
 			}
 		}
 	}
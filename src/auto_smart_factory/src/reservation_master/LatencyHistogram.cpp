@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <sstream>
+
+#include "reservation_master/LatencyHistogram.h"
+
+const std::vector<double> LatencyHistogram::bucketBounds = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+
+LatencyHistogram::LatencyHistogram() :
+	bucketCounts(bucketBounds.size() + 1, 0),
+	count(0),
+	sum(0),
+	max(0)
+{}
+
+void LatencyHistogram::add(double latency) {
+	double milliseconds = latency * 1000.0;
+	auto bucket = std::lower_bound(bucketBounds.begin(), bucketBounds.end(), milliseconds) - bucketBounds.begin();
+	bucketCounts[bucket]++;
+	
+	count++;
+	sum += milliseconds;
+	max = std::max(max, milliseconds);
+}
+
+void LatencyHistogram::clear() {
+	std::fill(bucketCounts.begin(), bucketCounts.end(), 0);
+	count = 0;
+	sum = 0;
+	max = 0;
+}
+
+int LatencyHistogram::getCount() const {
+	return count;
+}
+
+std::string LatencyHistogram::toString() const {
+	std::ostringstream stream;
+	stream.precision(1);
+	stream << std::fixed << count << " requests, mean " << (count > 0 ? sum / count : 0) << " ms, max " << max << " ms |";
+	
+	for(unsigned long i = 0; i < bucketCounts.size(); i++) {
+		if(bucketCounts[i] == 0) {
+			continue;
+		}
+		
+		if(i < bucketBounds.size()) {
+			stream << " <=" << static_cast<int>(bucketBounds[i]) << "ms: " << bucketCounts[i];
+		} else {
+			stream << " >" << static_cast<int>(bucketBounds.back()) << "ms: " << bucketCounts[i];
+		}
+	}
+	
+	return stream.str();
+}
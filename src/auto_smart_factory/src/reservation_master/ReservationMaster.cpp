@@ -1,59 +1,196 @@
 
 #include <include/reservation_master/ReservationMaster.h>
 
+#include <algorithm>
+
 #include "reservation_master/ReservationMaster.h"
 #include "auto_smart_factory/ReservationBroadcast.h"
+#include "auto_smart_factory/GetWarehouseConfig.h"
+#include "Math.h"
+#include "agent/path_planning/ReservationCodec.h"
 
-ReservationMaster::ReservationMaster() {
+ReservationMaster::ReservationMaster() :
+	batchWindow(0.01),
+	auctionRounds(0),
+	grantedRequests(0),
+	deniedRequests(0)
+{
 	ros::NodeHandle pn("~");
+	pn.param("batch_window", batchWindow, batchWindow);
+	
+	// The reservation table is indexed over the map area. It starts with the idle reservations every agent's map is initialized with, in the same order so that the ids match.
+	// Without the map configuration the ids would differ from the ones of the agents
+	std::string srvName = "config_server/get_map_configuration";
+	auto_smart_factory::GetWarehouseConfig srv;
+	ros::service::waitForService(srvName);
+	if(!ros::service::call(srvName, srv)) {
+		ROS_FATAL("[Reservation Master] Failed to call service %s! Reservation master could not create the reservation table.", srvName.c_str());
+		ros::shutdown();
+		return;
+	}
+	
+	const auto_smart_factory::WarehouseConfiguration& warehouseConfig = srv.response.warehouse_configuration;
+	double infiniteReservationStartTime = ros::Time::now().toSec() - 1000;
+	double infiniteReservationEndTime = ros::Time::now().toSec() + 100000;
+	
+	std::vector<Rectangle> idleReservations;
+	for(const auto& idlePosition : warehouseConfig.idle_positions) {
+		int id = std::stoi(idlePosition.id.substr(idlePosition.id.find('_') + 1));
+		Point pos = Point(static_cast<float>(idlePosition.pose.x), static_cast<float>(idlePosition.pose.y));
+		idleReservations.emplace_back(pos, Point(ROBOT_RADIUS * 2.0f, ROBOT_RADIUS * 2.0f), 0, infiniteReservationStartTime, infiniteReservationEndTime, id);
+	}
+	
+	reservationTable = ReservationTable(warehouseConfig.map_configuration.width, warehouseConfig.map_configuration.height, idleReservations);
+	ROS_INFO("[Reservation Master] Arbitrating requests within %.0f ms batches", batchWindow * 1000.0);
 	
 	reservationBroadcastPublisher = pn.advertise<auto_smart_factory::ReservationBroadcast>("/reservation_broadcast", 100, true);
 	reservationRequestSubscriber = pn.subscribe("/reservation_request", 100, &ReservationMaster::reservationRequestCallback, this);
+	snapshotService = pn.advertiseService("get_reservation_snapshot", &ReservationMaster::snapshotCallback, this);
 }
 
 void ReservationMaster::update() {
-	if(!requests.empty()) {
-		double highestBid = -1.f;
-		int highestRequestIndex = -1;
+	reservationTable.deleteExpiredReservations(ros::Time::now().toSec());
+	
+	if(!requests.empty() && ros::WallTime::now() >= batchDeadline) {
 		std::vector<int> emergencyStopRequests;
 		
 		for(int i = 0; i < requests.size(); i++) {
 			if(requests[i].isEmergencyStop) {
 				emergencyStopRequests.push_back(i);
-				continue;
-			}
-			
-			if(requests[i].bid > highestBid) {
-				highestBid = requests[i].bid;
-				highestRequestIndex = i;
 			}
 		}
 		
 		if(!emergencyStopRequests.empty()) {
 			for(int i = 0; i < requests.size(); i++) {
-				if(std::find(emergencyStopRequests.begin(), emergencyStopRequests.end(), i) != emergencyStopRequests.end()) {
-					sendEmergencyStopBroadcastMessage(i);
+				std::vector<Rectangle> reservations;
+				if(std::find(emergencyStopRequests.begin(), emergencyStopRequests.end(), i) != emergencyStopRequests.end() && getRequestedReservations(i, reservations)) {
+					sendReservationBroadcastMessage(i, reservations);
 				} else {
 					sendDenyMessage(i);		
 				}
 			}			
 		} else {
-			sendReservationBroadcastMessage(highestRequestIndex);
-
-			// Send deny to others
+			// All reservations are broadcasted before the denials, so losing agents replan with the reservations of this round
+			std::vector<int> winners = runAuction();
+			
 			for(int i = 0; i < requests.size(); i++) {
-				if(i != highestRequestIndex) {
+				if(std::find(winners.begin(), winners.end(), i) == winners.end()) {
 					sendDenyMessage(i);
 				}
 			}
+			
+			auctionRounds++;
+			grantedRequests += winners.size();
+			deniedRequests += requests.size() - winners.size();
+			if(auctionRounds == statisticsReportInterval) {
+				ROS_INFO("[Reservation Master] %.2f grants per round, %.1f%% of %d requests denied", static_cast<double>(grantedRequests) / auctionRounds, 100.0 * deniedRequests / (grantedRequests + deniedRequests), grantedRequests + deniedRequests);
+				ROS_INFO("[Reservation Master] Answer latency: %s", answerLatencies.toString().c_str());
+				auctionRounds = 0;
+				grantedRequests = 0;
+				deniedRequests = 0;
+				answerLatencies.clear();
+			}
 		}
 
 		requests.clear();
+		requestReceiptTimes.clear();
 	}	
 }
 
+double ReservationMaster::getTimeUntilUpdate() const {
+	if(requests.empty()) {
+		return idleTimeout;
+	}
+	
+	return std::max(0.0, (batchDeadline - ros::WallTime::now()).toSec());
+}
+
+std::vector<int> ReservationMaster::runAuction() {
+	// Highest bid first, earlier requests first on equal bids
+	std::vector<int> order(requests.size());
+	for(int i = 0; i < requests.size(); i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+		return requests[a].bid > requests[b].bid;
+	});
+	
+	std::vector<int> winners;
+	for(int i : order) {
+		// A second grant for the same agent would replace the first one
+		bool isOwnerGranted = std::any_of(winners.begin(), winners.end(), [&](int winner) {
+			return requests[winner].ownerId == requests[i].ownerId;
+		});
+		if(isOwnerGranted) {
+			continue;
+		}
+		
+		// Malformed requests are denied like losing ones
+		std::vector<Rectangle> reservations;
+		if(!getRequestedReservations(i, reservations)) {
+			continue;
+		}
+		
+		if(reservationTable.isConflictFree(reservations, requests[i].ownerId, requests[i].knownTableVersion)) {
+			sendReservationBroadcastMessage(i, reservations);
+			winners.push_back(i);
+		}
+	}
+	
+	return winners;
+}
+
+bool ReservationMaster::getRequestedReservations(int requestIndex, std::vector<Rectangle>& reservations) const {
+	if(!requests[requestIndex].compactReservations.empty()) {
+		int offset = 0;
+		if(!ReservationCodec::decodeReservations(requests[requestIndex].compactReservations, offset, reservations)) {
+			ROS_ERROR("[Reservation Master] Malformed compact reservations from agent %d, request is denied", requests[requestIndex].ownerId);
+			return false;
+		}
+		
+		return true;
+	}
+	
+	for(const auto& r : requests[requestIndex].reservations) {
+		reservations.emplace_back(Point(r.posX, r.posY), Point(r.sizeX, r.sizeY), r.rotation, r.startTime, r.endTime, r.ownerId, r.sweepDuration);
+	}
+	
+	return true;
+}
+
+auto_smart_factory::Rectangle ReservationMaster::getReservationMessage(const Rectangle& reservation) {
+	auto_smart_factory::Rectangle rectangle;
+	rectangle.posX = reservation.getPosition().x;
+	rectangle.posY = reservation.getPosition().y;
+	rectangle.sizeX = reservation.getSize().x;
+	rectangle.sizeY = reservation.getSize().y;
+	rectangle.rotation = reservation.getRotation();
+	rectangle.startTime = reservation.getStartTime();
+	rectangle.endTime = reservation.getEndTime();
+	rectangle.ownerId = reservation.getOwnerId();
+	rectangle.sweepDuration = reservation.getSweepDuration();
+	
+	return rectangle;
+}
+
 void ReservationMaster::reservationRequestCallback(const auto_smart_factory::ReservationRequest& msg) {
-	requests.push_back(msg);	
+	ros::WallTime now = ros::WallTime::now();
+	
+	// The first request opens a new batch. Emergency stops close it right away
+	if(requests.empty()) {
+		batchDeadline = now + ros::WallDuration(batchWindow);
+	}
+	if(msg.isEmergencyStop) {
+		batchDeadline = now;
+	}
+	
+	requests.push_back(msg);
+	requestReceiptTimes.push_back(now);
+}
+
+void ReservationMaster::publishAnswer(int requestIndex, const auto_smart_factory::ReservationBroadcast& msg) {
+	reservationBroadcastPublisher.publish(msg);
+	answerLatencies.add((ros::WallTime::now() - requestReceiptTimes[requestIndex]).toSec());
 }
 
 void ReservationMaster::sendDenyMessage(int requestIndex) {
@@ -61,25 +198,61 @@ void ReservationMaster::sendDenyMessage(int requestIndex) {
 	auto_smart_factory::ReservationBroadcast msg;
 	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(false);
 	msg.ownerId = requests[requestIndex].ownerId;
-	reservationBroadcastPublisher.publish(msg);
+	msg.tableVersion = reservationTable.getVersion();
+	publishAnswer(requestIndex, msg);
 }
 
-void ReservationMaster::sendReservationBroadcastMessage(int requestIndex) {
-	//ROS_INFO("[Reservation Master] Agent %d won auction", requests[highestRequestIndex].ownerId);
+void ReservationMaster::sendReservationBroadcastMessage(int requestIndex, const std::vector<Rectangle>& reservations) {
+	//ROS_INFO("[Reservation Master] Agent %d won auction", requests[requestIndex].ownerId);
+	ReservationTable::Delta delta = reservationTable.setReservations(requests[requestIndex].ownerId, reservations);
+	
 	auto_smart_factory::ReservationBroadcast msg;
 	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
-	msg.isEmergencyStop = static_cast<unsigned char>(false);
+	msg.isEmergencyStop = requests[requestIndex].isEmergencyStop;
 	msg.ownerId = requests[requestIndex].ownerId;
-	msg.reservations = requests[requestIndex].reservations;
-	reservationBroadcastPublisher.publish(msg);
+	
+	// Replaced reservations were usually added together, so their ids form few runs
+	std::vector<unsigned long> removedIdRanges;
+	for(int i = 0; i < delta.removedIds.size(); i++) {
+		if(i == 0 || delta.removedIds[i] != delta.removedIds[i - 1] + 1) {
+			removedIdRanges.push_back(delta.removedIds[i]);
+			removedIdRanges.push_back(delta.removedIds[i]);
+		} else {
+			removedIdRanges.back() = delta.removedIds[i];
+		}
+	}
+	
+	// Answer in the encoding of the request
+	if(!requests[requestIndex].compactReservations.empty()) {
+		std::vector<Rectangle> addedReservations;
+		for(int i : delta.addedIndices) {
+			addedReservations.push_back(reservations[i]);
+		}
+		std::vector<unsigned long> ids = {delta.firstAddedId};
+		ids.insert(ids.end(), removedIdRanges.begin(), removedIdRanges.end());
+		
+		ReservationCodec::encodeReservations(addedReservations, msg.compactReservations);
+		ReservationCodec::encodeIds(ids, msg.compactReservations);
+	} else {
+		for(int i : delta.addedIndices) {
+			msg.reservations.push_back(getReservationMessage(reservations[i]));
+		}
+		msg.firstReservationId = delta.firstAddedId;
+		msg.removedReservationIdRanges = removedIdRanges;
+	}
+	msg.tableVersion = reservationTable.getVersion();
+	publishAnswer(requestIndex, msg);
 }
 
-void ReservationMaster::sendEmergencyStopBroadcastMessage(int requestIndex) {
-	//ROS_INFO("[Reservation Master] Sending emergency stop for agent %d", requests[requestIndex].ownerId);
-	auto_smart_factory::ReservationBroadcast msg;
-	msg.isReservationBroadcastOrDenial = static_cast<unsigned char>(true);
-	msg.isEmergencyStop = static_cast<unsigned char>(true);
-	msg.ownerId = requests[requestIndex].ownerId;
-	msg.reservations = requests[requestIndex].reservations;
-	reservationBroadcastPublisher.publish(msg);
+bool ReservationMaster::snapshotCallback(auto_smart_factory::GetReservationSnapshot::Request& req, auto_smart_factory::GetReservationSnapshot::Response& res) {
+	std::vector<Rectangle> reservations;
+	reservationTable.getSnapshot(reservations, res.reservationIds);
+	
+	for(const Rectangle& r : reservations) {
+		res.reservations.push_back(getReservationMessage(r));
+	}
+	res.tableVersion = reservationTable.getVersion();
+	
+	ROS_INFO("[Reservation Master] Sent snapshot of %d reservations at version %lu", (int) reservations.size(), reservationTable.getVersion());
+	return true;
 }
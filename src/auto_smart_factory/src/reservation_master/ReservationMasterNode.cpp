@@ -1,5 +1,6 @@
 #include <include/reservation_master/ReservationMaster.h>
 #include "ros/ros.h"
+#include "ros/callback_queue.h"
 
 int main(int argc, char** argv) {
 	ros::init(argc, argv, "reservation_master");
@@ -8,10 +9,9 @@ int main(int argc, char** argv) {
 	ReservationMaster reservationMaster;
 	ROS_INFO("Reservation master ready!");
 
-	ros::Rate r(10);
+	// Requests are handled as soon as they arrive instead of at a fixed rate. Waiting ends when a request arrives or the current batch is complete
 	while(ros::ok()) {
+		ros::getGlobalCallbackQueue()->callAvailable(ros::WallDuration(reservationMaster.getTimeUntilUpdate()));
 		reservationMaster.update();
-		ros::spinOnce();
-		r.sleep();
 	}
 }
@@ -0,0 +1,148 @@
+#include <algorithm>
+
+#include "reservation_master/ReservationTable.h"
+#include "Math.h"
+
+ReservationTable::ReservationTable(float width, float height, const std::vector<Rectangle>& initialReservations) :
+	reservationIndex(width, height, reservationIndexCellSize)
+{
+	for(const Rectangle& reservation : initialReservations) {
+		reservationSlotsByOwner[reservation.getOwnerId()].push_back(addReservation(reservation, reservation.getOwnerId()));
+	}
+}
+
+bool ReservationTable::isConflictFree(const std::vector<Rectangle>& requestedReservations, int ownerId, unsigned long knownVersion) const {
+	// Nothing was added since the agent planned
+	if(knownVersion >= version) {
+		return true;
+	}
+	
+	for(const Rectangle& reservation : requestedReservations) {
+		bool isFree = true;
+		reservationIndex.forEachCandidateInArea(reservation.getMinXInflated(), reservation.getMinYInflated(), reservation.getMaxXInflated(), reservation.getMaxYInflated(), reservation.getStartTime(), reservation.getEndTime(), [&](int slot) {
+			if(isFree && reservationVersions[slot] > knownVersion && reservationOwners[slot] != ownerId && Math::doReservationsOverlap(reservation, reservations[slot])) {
+				isFree = false;
+			}
+		});
+		
+		if(!isFree) {
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+ReservationTable::Delta ReservationTable::setReservations(int ownerId, const std::vector<Rectangle>& newReservations) {
+	Delta delta;
+	std::vector<int>& ownerSlots = reservationSlotsByOwner[ownerId];
+	std::vector<int> keptSlots;
+	version++;
+	
+	// Reservations which are part of the old and the new reservations are kept, so they do not need to be broadcasted again
+	for(int i = 0; i < newReservations.size(); i++) {
+		auto oldSlot = std::find_if(ownerSlots.begin(), ownerSlots.end(), [&](int slot) {
+			return isSameReservation(reservations[slot], newReservations[i]);
+		});
+		
+		if(oldSlot != ownerSlots.end()) {
+			keptSlots.push_back(*oldSlot);
+			ownerSlots.erase(oldSlot);
+		} else {
+			delta.addedIndices.push_back(i);
+		}
+	}
+	
+	for(int slot : ownerSlots) {
+		delta.removedIds.push_back(reservationIds[slot]);
+		deleteReservation(slot);
+	}
+	std::sort(delta.removedIds.begin(), delta.removedIds.end());
+	ownerSlots = keptSlots;
+	
+	delta.firstAddedId = nextReservationId;
+	for(int i : delta.addedIndices) {
+		ownerSlots.push_back(addReservation(newReservations[i], ownerId));
+	}
+	
+	return delta;
+}
+
+void ReservationTable::getSnapshot(std::vector<Rectangle>& allReservations, std::vector<unsigned long>& ids) const {
+	std::vector<int> slots;
+	for(int slot = 0; slot < reservations.size(); slot++) {
+		if(isReservationSlotUsed[slot]) {
+			slots.push_back(slot);
+		}
+	}
+	std::sort(slots.begin(), slots.end(), [&](int a, int b) {
+		return reservationIds[a] < reservationIds[b];
+	});
+	
+	allReservations.clear();
+	ids.clear();
+	for(int slot : slots) {
+		allReservations.push_back(reservations[slot]);
+		ids.push_back(reservationIds[slot]);
+	}
+}
+
+void ReservationTable::deleteExpiredReservations(double time) {
+	while(!reservationExpiryQueue.empty() && reservationExpiryQueue.top().first < time) {
+		int slot = reservationExpiryQueue.top().second;
+		reservationExpiryQueue.pop();
+		
+		// The slot may have been reused for a reservation which ends later
+		if(isReservationSlotUsed[slot] && reservations[slot].getEndTime() < time) {
+			std::vector<int>& ownerSlots = reservationSlotsByOwner[reservationOwners[slot]];
+			ownerSlots.erase(std::find(ownerSlots.begin(), ownerSlots.end(), slot));
+			deleteReservation(slot);
+		}
+	}
+}
+
+unsigned long ReservationTable::getVersion() const {
+	return version;
+}
+
+int ReservationTable::getReservationCount() const {
+	return usedReservationSlotCount;
+}
+
+int ReservationTable::addReservation(const Rectangle& reservation, int ownerId) {
+	int slot;
+	if(!freeReservationSlots.empty()) {
+		slot = freeReservationSlots.back();
+		freeReservationSlots.pop_back();
+		reservations[slot] = reservation;
+		reservationOwners[slot] = ownerId;
+		reservationIds[slot] = nextReservationId++;
+		reservationVersions[slot] = version;
+		isReservationSlotUsed[slot] = true;
+	} else {
+		slot = static_cast<int>(reservations.size());
+		reservations.push_back(reservation);
+		reservationOwners.push_back(ownerId);
+		reservationIds.push_back(nextReservationId++);
+		reservationVersions.push_back(version);
+		isReservationSlotUsed.push_back(true);
+	}
+	
+	reservationIndex.add(slot, reservation);
+	reservationExpiryQueue.emplace(reservation.getEndTime(), slot);
+	usedReservationSlotCount++;
+	
+	return slot;
+}
+
+void ReservationTable::deleteReservation(int slot) {
+	reservationIndex.remove(slot, reservations[slot]);
+	isReservationSlotUsed[slot] = false;
+	freeReservationSlots.push_back(slot);
+	usedReservationSlotCount--;
+}
+
+bool ReservationTable::isSameReservation(const Rectangle& r1, const Rectangle& r2) {
+	return r1.getPosition().x == r2.getPosition().x && r1.getPosition().y == r2.getPosition().y && r1.getSize().x == r2.getSize().x && r1.getSize().y == r2.getSize().y
+		&& r1.getRotation() == r2.getRotation() && r1.getStartTime() == r2.getStartTime() && r1.getEndTime() == r2.getEndTime() && r1.getSweepDuration() == r2.getSweepDuration();
+}
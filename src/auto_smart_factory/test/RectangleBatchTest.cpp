@@ -0,0 +1,125 @@
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Math.h"
+#include "agent/path_planning/RectangleBatch.h"
+
+/* Randomized equivalence test of the batch intersection kernels against the scalar rectangle checks.
+ * The kernels are compiled with SSE2 or AVX depending on the build flags, so every build configuration has to pass it */
+class RectangleBatchTest : public ::testing::Test {
+protected:
+	std::mt19937 rng;
+	std::uniform_real_distribution<double> uniform;
+	std::vector<Rectangle> rectangles;
+
+	RectangleBatchTest() :
+		rng(42),
+		uniform(0, 1)
+	{
+		// Half of the rectangles are axis aligned, the others have arbitrary rotations
+		for(int i = 0; i < 4000; i++) {
+			float rotation = uniform(rng) < 0.5 ? 90.f * static_cast<int>(uniform(rng) * 4) : static_cast<float>(uniform(rng) * 360);
+			rectangles.emplace_back(Point(uniform(rng) * 20, uniform(rng) * 20), Point(0.1 + uniform(rng) * 5, 0.1 + uniform(rng) * 5), rotation);
+		}
+	}
+
+	/** Random point near the rectangle. Points on the bounding box border and on corners are generated on purpose, there the kernels are most likely to differ
+	 * @param rectangle The rectangle
+	 * @return The point */
+	Point getPointNear(const Rectangle& rectangle) {
+		double kind = uniform(rng);
+		if(kind < 0.2) {
+			return Point(rectangle.getMinXInflated(), rectangle.getMinYInflated() + uniform(rng) * (rectangle.getMaxYInflated() - rectangle.getMinYInflated()));
+		} else if(kind < 0.3) {
+			return Point(rectangle.getMinXInflated() + uniform(rng) * (rectangle.getMaxXInflated() - rectangle.getMinXInflated()), rectangle.getMaxYInflated());
+		} else if(kind < 0.4) {
+			return rectangle.getPointsInflated()[static_cast<int>(uniform(rng) * 4)];
+		}
+
+		return Point(uniform(rng) * 24 - 2, uniform(rng) * 24 - 2);
+	}
+
+	/** Random line segment end for the given start. Includes points, horizontal and vertical segments
+	 * @param start Start of the line segment
+	 * @param rectangle The rectangle the segment should be near
+	 * @return The end of the line segment */
+	Point getSegmentEnd(const Point& start, const Rectangle& rectangle) {
+		double kind = uniform(rng);
+		if(kind < 0.1) {
+			return start;
+		} else if(kind < 0.2) {
+			return Point(start.x, uniform(rng) * 24 - 2);
+		} else if(kind < 0.3) {
+			return Point(uniform(rng) * 24 - 2, start.y);
+		}
+
+		return getPointNear(rectangle);
+	}
+};
+
+TEST_F(RectangleBatchTest, SingleRectangleMatchesScalarChecks) {
+	RectangleBatch batch(rectangles);
+	int segmentHits = 0;
+	int pointHits = 0;
+
+	for(int i = 0; i < 200000; i++) {
+		int index = static_cast<int>(uniform(rng) * rectangles.size());
+		Point start = getPointNear(rectangles[index]);
+		Point end = getSegmentEnd(start, rectangles[index]);
+
+		bool segmentHit = Math::doesLineSegmentIntersectRectangle(start, end, rectangles[index]);
+		bool pointHit = Math::isPointInRectangle(start, rectangles[index]);
+		ASSERT_EQ(segmentHit, Math::doesLineSegmentIntersectAnyRectangle(start, end, batch, index, index + 1)) << "rectangle " << index;
+		ASSERT_EQ(pointHit, Math::isPointInAnyRectangle(start, batch, index, index + 1)) << "rectangle " << index;
+
+		segmentHits += segmentHit;
+		pointHits += pointHit;
+	}
+
+	// Both outcomes have to be covered for the test to mean anything
+	EXPECT_GT(segmentHits, 20000);
+	EXPECT_LT(segmentHits, 180000);
+	EXPECT_GT(pointHits, 20000);
+	EXPECT_LT(pointHits, 180000);
+}
+
+TEST_F(RectangleBatchTest, RangesMatchScalarChecks) {
+	RectangleBatch batch(rectangles);
+
+	// Ranges start at arbitrary offsets, so partially used lanes at both ends are covered
+	for(int i = 0; i < 200000; i++) {
+		int first = static_cast<int>(uniform(rng) * (rectangles.size() - 8));
+		int last = first + 1 + static_cast<int>(uniform(rng) * 8);
+		Point start = getPointNear(rectangles[first]);
+		Point end = getSegmentEnd(start, rectangles[last - 1]);
+
+		bool segmentHit = false;
+		bool pointHit = false;
+		for(int j = first; j < last; j++) {
+			segmentHit |= Math::doesLineSegmentIntersectRectangle(start, end, rectangles[j]);
+			pointHit |= Math::isPointInRectangle(start, rectangles[j]);
+		}
+
+		ASSERT_EQ(segmentHit, Math::doesLineSegmentIntersectAnyRectangle(start, end, batch, first, last)) << "rectangles " << first << " to " << last;
+		ASSERT_EQ(pointHit, Math::isPointInAnyRectangle(start, batch, first, last)) << "rectangles " << first << " to " << last;
+	}
+}
+
+TEST_F(RectangleBatchTest, PaddingNeverIntersects) {
+	// The batch is padded to whole lanes, a segment crossing the whole plane must only see the real rectangle
+	std::vector<Rectangle> single = {rectangles.front()};
+	RectangleBatch batch(single);
+
+	for(int i = 0; i < 1000; i++) {
+		Point start(uniform(rng) * 2000 - 1000, -1000);
+		Point end(uniform(rng) * 2000 - 1000, 1000);
+		ASSERT_EQ(Math::doesLineSegmentIntersectRectangle(start, end, single.front()), Math::doesLineSegmentIntersectAnyRectangle(start, end, batch, 0, 1));
+	}
+	EXPECT_FALSE(Math::isPointInAnyRectangle(single.front().getPosition(), batch, 0, 0));
+}
+
+int main(int argc, char** argv) {
+	testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
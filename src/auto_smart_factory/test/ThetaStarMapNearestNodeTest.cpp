@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "ros/ros.h"
+#include "Math.h"
+#include "agent/path_planning/Map.h"
+#include "agent/path_planning/ThetaStarMap.h"
+
+/* Compares the ring search of ThetaStarMap::getNodeClosestTo against a linear scan over all grid and additional nodes */
+class ThetaStarMapNearestNodeTest : public ::testing::Test {
+protected:
+	RobotHardwareProfile hardwareProfile;
+	std::vector<Rectangle> obstacles;
+	Map* map;
+	ThetaStarMap* thetaStarMap;
+
+	ThetaStarMapNearestNodeTest() :
+		hardwareProfile(1.0, Math::toDeg(2.0), 0.1, 1.5)
+	{
+		// Walled 16 x 14 m warehouse with two shelf rows, the rows leave gaps in the grid
+		auto_smart_factory::WarehouseConfiguration warehouseConfig;
+		warehouseConfig.width = 16;
+		warehouseConfig.height = 14;
+		warehouseConfig.map_configuration.width = 16;
+		warehouseConfig.map_configuration.height = 14;
+		warehouseConfig.map_configuration.margin = 0.5;
+		warehouseConfig.map_configuration.resolutionThetaStar = 0.5;
+
+		obstacles.emplace_back(Point(8, 0), Point(16, 0.5), 0);
+		obstacles.emplace_back(Point(8, 14), Point(16, 0.5), 0);
+		obstacles.emplace_back(Point(0, 7), Point(0.5, 14), 0);
+		obstacles.emplace_back(Point(16, 7), Point(0.5, 14), 0);
+		obstacles.emplace_back(Point(7, 4.5), Point(10, 0.5), 0);
+		obstacles.emplace_back(Point(9, 9.5), Point(10, 0.5), 0);
+
+		map = new Map(warehouseConfig, obstacles, &hardwareProfile, 0);
+		thetaStarMap = new ThetaStarMap(map, 0.5);
+	}
+
+	~ThetaStarMapNearestNodeTest() override {
+		delete thetaStarMap;
+		delete map;
+	}
+
+	/** Linear scan over all nodes, preferring the lower id on ties
+	 * @param pos Query point
+	 * @return The nearest node */
+	const GridNode* getNodeClosestToByScan(const Point& pos) const {
+		const GridNode* nearestNode = nullptr;
+		double shortestDistance = 0;
+
+		for(int id = 0; id < thetaStarMap->getNodeCount(); id++) {
+			const GridNode* node = thetaStarMap->getNode(id);
+			double distance = Math::getDistanceSquared(node->getPosition(), pos);
+			if(nearestNode == nullptr || distance < shortestDistance) {
+				shortestDistance = distance;
+				nearestNode = node;
+			}
+		}
+
+		return nearestNode;
+	}
+
+	/** Adds tray approach points like the agents do: off the grid, some of them next to a cell border
+	 * @return Number of added nodes */
+	int addTrayNodes() {
+		std::vector<Point> positions = {
+			Point(3.3, 7.1), Point(3.3, 7.9), Point(10.85, 3.2), Point(10.75, 11.25),
+			Point(5.24, 5.74), Point(5.25, 5.75), Point(12.01, 8.49), Point(14.6, 12.4)
+		};
+
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<double> xDistribution(1, 15);
+		std::uniform_real_distribution<double> yDistribution(1, 13);
+		for(int i = 0; i < 40; i++) {
+			positions.emplace_back(xDistribution(rng), yDistribution(rng));
+		}
+
+		int nodeCount = thetaStarMap->getNodeCount();
+		thetaStarMap->addAdditionalNodes(positions);
+		return thetaStarMap->getNodeCount() - nodeCount;
+	}
+};
+
+TEST_F(ThetaStarMapNearestNodeTest, RandomPointsMatchScan) {
+	ASSERT_GT(addTrayNodes(), 30);
+
+	// Also covers points outside the map, where the search starts in a ring without nodes
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<double> xDistribution(-3, 19);
+	std::uniform_real_distribution<double> yDistribution(-3, 17);
+	for(int i = 0; i < 5000; i++) {
+		Point pos(xDistribution(rng), yDistribution(rng));
+		ASSERT_EQ(getNodeClosestToByScan(pos)->id, thetaStarMap->getNodeClosestTo(pos)->id) << "at " << pos.x << ", " << pos.y;
+	}
+}
+
+TEST_F(ThetaStarMapNearestNodeTest, CellBordersMatchScan) {
+	int gridNodeCount = thetaStarMap->getNodeCount();
+	ASSERT_GT(addTrayNodes(), 30);
+
+	// Points half a cell away from a grid node lie on the border between two or four cells, most of them equidistant to two or four grid nodes
+	const double offsets[][2] = {{0.25, 0}, {-0.25, 0}, {0, 0.25}, {0, -0.25}, {0.25, 0.25}, {-0.25, 0.25}, {0.25, -0.25}, {-0.25, -0.25}};
+	for(int id = 0; id < gridNodeCount; id++) {
+		const Point& nodePosition = thetaStarMap->getNode(id)->getPosition();
+		for(const auto& offset : offsets) {
+			Point pos(nodePosition.x + offset[0], nodePosition.y + offset[1]);
+			ASSERT_EQ(getNodeClosestToByScan(pos)->id, thetaStarMap->getNodeClosestTo(pos)->id) << "at " << pos.x << ", " << pos.y;
+		}
+	}
+}
+
+TEST_F(ThetaStarMapNearestNodeTest, TiesPreferLowerId) {
+	// Grid nodes are at multiples of 0.5, so all distances below are exact. The query point lies in cell (6, 14), the first tray node in cell (5, 14)
+	Point pos(3.25, 7.25);
+	ASSERT_EQ(3, thetaStarMap->addAdditionalNodes({Point(3.125, 7.25), Point(3.375, 7.25), Point(3.25, 7.375)}));
+	int firstTrayId = thetaStarMap->getNodeCount() - 3;
+
+	// Three tray nodes at the same distance, the one with the lowest id is only found in the second ring
+	EXPECT_EQ(firstTrayId, thetaStarMap->getNodeClosestTo(pos)->id);
+	EXPECT_EQ(getNodeClosestToByScan(pos)->id, thetaStarMap->getNodeClosestTo(pos)->id);
+
+	// Between two grid nodes, the tray nodes are further away
+	Point border(3.25, 7);
+	int leftId = getNodeClosestToByScan(Point(3, 7))->id;
+	int rightId = getNodeClosestToByScan(Point(3.5, 7))->id;
+	ASSERT_EQ(3.0, thetaStarMap->getNode(leftId)->getPosition().x);
+	ASSERT_EQ(3.5, thetaStarMap->getNode(rightId)->getPosition().x);
+	EXPECT_EQ(std::min(leftId, rightId), thetaStarMap->getNodeClosestTo(border)->id);
+}
+
+int main(int argc, char** argv) {
+	testing::InitGoogleTest(&argc, argv);
+	ros::Time::init();
+	return RUN_ALL_TESTS();
+}
@@ -0,0 +1,169 @@
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "ros/ros.h"
+#include "agent/path_planning/Map.h"
+#include "agent/path_planning/ThetaStarMap.h"
+#include "agent/path_planning/ThetaStarSearchArena.h"
+
+/* Counts heap allocations while allocationCounting is set, by replacing the global operator new */
+namespace {
+	bool allocationCounting = false;
+	long allocationCount = 0;
+}
+
+void* operator new(std::size_t size) {
+	if(allocationCounting) {
+		allocationCount++;
+	}
+
+	void* p = std::malloc(size == 0 ? 1 : size);
+	if(p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+class ThetaStarSearchArenaTest : public ::testing::Test {
+protected:
+	RobotHardwareProfile hardwareProfile;
+	std::vector<Rectangle> obstacles;
+	Map* map;
+
+	ThetaStarSearchArenaTest() :
+		hardwareProfile(1.0, Math::toDeg(2.0), 0.1, 1.5)
+	{
+		// Walled 16 x 14 m warehouse with two shelf rows and a closed room in the lower right corner
+		auto_smart_factory::WarehouseConfiguration warehouseConfig;
+		warehouseConfig.width = 16;
+		warehouseConfig.height = 14;
+		warehouseConfig.map_configuration.width = 16;
+		warehouseConfig.map_configuration.height = 14;
+		warehouseConfig.map_configuration.margin = 0.5;
+		warehouseConfig.map_configuration.resolutionThetaStar = 0.5;
+
+		obstacles.emplace_back(Point(8, 0), Point(16, 0.5), 0);
+		obstacles.emplace_back(Point(8, 14), Point(16, 0.5), 0);
+		obstacles.emplace_back(Point(0, 7), Point(0.5, 14), 0);
+		obstacles.emplace_back(Point(16, 7), Point(0.5, 14), 0);
+		obstacles.emplace_back(Point(7, 4.5), Point(10, 0.5), 0);
+		obstacles.emplace_back(Point(9, 9.5), Point(10, 0.5), 0);
+		obstacles.emplace_back(Point(13.75, 4), Point(4.5, 0.5), 0);
+		obstacles.emplace_back(Point(11.5, 2), Point(0.5, 4), 0);
+
+		map = new Map(warehouseConfig, obstacles, &hardwareProfile, 0);
+	}
+
+	~ThetaStarSearchArenaTest() override {
+		delete map;
+	}
+
+	/** Plans a path with the single target search, which is not cached by the map
+	 * @param start Path start
+	 * @param target Path target
+	 * @return The path */
+	Path planUncached(const OrientedPoint& start, const OrientedPoint& target) {
+		int targetIndex;
+		return map->getThetaStarPathToNearest(start, {target}, ros::Time::now().toSec(), 0, false, targetIndex);
+	}
+
+	/** Counts the heap allocations of an uncached path query
+	 * @param start Path start
+	 * @param target Path target
+	 * @return Number of allocations */
+	long countPlanningAllocations(const OrientedPoint& start, const OrientedPoint& target) {
+		std::vector<OrientedPoint> targets = {target};
+		int targetIndex;
+		double now = ros::Time::now().toSec();
+
+		allocationCount = 0;
+		allocationCounting = true;
+		Path path = map->getThetaStarPathToNearest(start, targets, now, 0, false, targetIndex);
+		allocationCounting = false;
+
+		return allocationCount;
+	}
+};
+
+TEST_F(ThetaStarSearchArenaTest, ReusedArenaDoesNotAllocate) {
+	ThetaStarMap thetaStarMap(map, 0.5);
+
+	// Touches every node and runs it through the open list, like a search exploring the whole map
+	auto runQuery = [&]() {
+		std::unique_ptr<ThetaStarSearchArena> arena = thetaStarMap.acquireSearchArena();
+		ThetaStarOpenList& openList = arena->getOpenList();
+
+		for(int id = 0; id < thetaStarMap.getNodeCount(); id++) {
+			ThetaStarGridNodeInformation* information = arena->getInformation(thetaStarMap.getNode(id), std::numeric_limits<double>::max());
+			information->time = id % 7;
+			openList.push(information, information->time);
+		}
+		while(!openList.empty()) {
+			openList.pop();
+		}
+
+		thetaStarMap.releaseSearchArena(std::move(arena));
+	};
+
+	ASSERT_GT(thetaStarMap.getNodeCount(), 100);
+	runQuery();
+
+	allocationCount = 0;
+	allocationCounting = true;
+	runQuery();
+	runQuery();
+	allocationCounting = false;
+
+	EXPECT_EQ(0, allocationCount);
+}
+
+TEST_F(ThetaStarSearchArenaTest, ReusedArenaStartsEmpty) {
+	ThetaStarMap thetaStarMap(map, 0.5);
+	const GridNode* node = thetaStarMap.getNode(0);
+
+	std::unique_ptr<ThetaStarSearchArena> arena = thetaStarMap.acquireSearchArena();
+	ThetaStarGridNodeInformation* information = arena->getInformation(node, 5);
+	information->time = 1;
+	arena->getOpenList().push(information, 1);
+	thetaStarMap.releaseSearchArena(std::move(arena));
+
+	// The next query sees the initial state again
+	arena = thetaStarMap.acquireSearchArena();
+	EXPECT_TRUE(arena->getOpenList().empty());
+	EXPECT_EQ(5, arena->getInformation(node, 5)->time);
+	EXPECT_EQ(nullptr, arena->getInformation(node, 5)->prev);
+	thetaStarMap.releaseSearchArena(std::move(arena));
+}
+
+TEST_F(ThetaStarSearchArenaTest, PlanningAllocationsDoNotGrowWithTheSearch) {
+	OrientedPoint hall(1.5, 1.5, 0);
+	OrientedPoint room(13.75, 2, 0);
+
+	// Both queries fail after exploring everything reachable from their start, the whole hall or only the room. No path is constructed
+	ASSERT_FALSE(planUncached(hall, room).isValid());
+	ASSERT_FALSE(planUncached(room, hall).isValid());
+
+	long hallAllocations = countPlanningAllocations(hall, room);
+	long roomAllocations = countPlanningAllocations(room, hall);
+
+	// Only the planner's goal list is allocated, the node state lives in the reused arena
+	EXPECT_EQ(roomAllocations, hallAllocations);
+	EXPECT_LE(hallAllocations, 2);
+}
+
+int main(int argc, char** argv) {
+	testing::InitGoogleTest(&argc, argv);
+	ros::Time::init();
+	return RUN_ALL_TESTS();
+}